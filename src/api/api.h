@@ -28,6 +28,8 @@ extern const luaL_Reg lovrChannel[];
 extern const luaL_Reg lovrCollider[];
 extern const luaL_Reg lovrCurve[];
 extern const luaL_Reg lovrCylinderShape[];
+extern const luaL_Reg lovrMeshShape[];
+extern const luaL_Reg lovrTerrainShape[];
 extern const luaL_Reg lovrDistanceJoint[];
 extern const luaL_Reg lovrFont[];
 extern const luaL_Reg lovrHingeJoint[];
@@ -61,6 +63,7 @@ extern const char* AttributeTypes[];
 extern const char* BlendAlphaModes[];
 extern const char* BlendModes[];
 extern const char* BlockTypes[];
+extern const char* BroadphaseTypes[];
 extern const char* BufferUsages[];
 extern const char* CompareModes[];
 extern const char* DrawModes[];
@@ -76,6 +79,10 @@ extern const char* JointTypes[];
 extern const char* MaterialColors[];
 extern const char* MaterialScalars[];
 extern const char* MaterialTextures[];
+extern const char* PacingModes[];
+extern const char* PoseFormats[];
+extern const char* ProfileFormats[];
+extern const char* RaycastModes[];
 extern const char* ShaderTypes[];
 extern const char* ShapeTypes[];
 extern const char* SourceTypes[];
@@ -102,12 +109,23 @@ int luax_pushvariant(lua_State* L, struct Variant* variant);
 #endif
 
 #ifdef LOVR_ENABLE_GRAPHICS
+#include <stdint.h>
 struct Attachment;
 struct Texture;
 struct Uniform;
 int luax_checkuniform(lua_State* L, int index, const struct Uniform* uniform, void* dest, const char* debug);
 int luax_optmipmap(lua_State* L, int index, struct Texture* texture);
 void luax_readattachments(lua_State* L, int index, struct Attachment* attachments, int* count);
+uint32_t luax_readinstances(lua_State* L, int index, float** transforms, float** colors);
+#endif
+
+#ifdef LOVR_ENABLE_PHYSICS
+#include <stdint.h>
+struct Shape;
+struct Shape* luax_newmeshshape(lua_State* L, int index);
+struct Shape* luax_newterrainshape(lua_State* L, int index);
+uint32_t luax_checkheights(lua_State* L, int index, uint32_t columns, uint32_t rows);
+void luax_readheights(lua_State* L, int index, float* heights, uint32_t count);
 #endif
 
 #ifdef LOVR_ENABLE_MATH
@@ -314,6 +314,10 @@ static int l_lovrGraphicsCreateWindow(lua_State* L) {
   flags.fullscreen = lua_toboolean(L, -1);
   lua_pop(L, 1);
 
+  lua_getfield(L, 1, "headless");
+  flags.headless = lua_toboolean(L, -1);
+  lua_pop(L, 1);
+
   lua_getfield(L, 1, "msaa");
   flags.msaa = lua_tointeger(L, -1);
   lua_pop(L, 1);
@@ -376,6 +380,14 @@ static int l_lovrGraphicsGetFeatures(lua_State* L) {
   lua_setfield(L, -2, "compute");
   lua_pushboolean(L, features->singlepass);
   lua_setfield(L, -2, "singlepass");
+  lua_pushboolean(L, features->timers);
+  lua_setfield(L, -2, "timers");
+  lua_pushboolean(L, features->indirect);
+  lua_setfield(L, -2, "indirect");
+  lua_pushboolean(L, features->multiDraw);
+  lua_setfield(L, -2, "multidraw");
+  lua_pushboolean(L, features->multiview);
+  lua_setfield(L, -2, "multiview");
   return 1;
 }
 
@@ -400,7 +412,7 @@ static int l_lovrGraphicsGetStats(lua_State* L) {
     luaL_checktype(L, 1, LUA_TTABLE);
     lua_settop(L, 1);
   } else {
-    lua_createtable(L, 0, 2);
+    lua_createtable(L, 0, 4);
   }
 
   lovrGraphicsFlush();
@@ -409,9 +421,70 @@ static int l_lovrGraphicsGetStats(lua_State* L) {
   lua_setfield(L, 1, "drawcalls");
   lua_pushinteger(L, stats->shaderSwitches);
   lua_setfield(L, 1, "shaderswitches");
+
+  uint32_t submitted, culled;
+  lovrGraphicsGetCullingStats(&submitted, &culled);
+  lua_pushinteger(L, submitted);
+  lua_setfield(L, 1, "submitted");
+  lua_pushinteger(L, culled);
+  lua_setfield(L, 1, "culled");
+
+  const GpuTimings* timings = &stats->timings;
+  if (timings->valid) {
+    lua_createtable(L, 0, 6);
+    lua_pushnumber(L, timings->total);
+    lua_setfield(L, -2, "total");
+    lua_pushnumber(L, timings->times[TIMER_DRAW]);
+    lua_setfield(L, -2, "draw");
+    lua_pushnumber(L, timings->times[TIMER_COMPUTE]);
+    lua_setfield(L, -2, "compute");
+    lua_pushnumber(L, timings->times[TIMER_RESOLVE]);
+    lua_setfield(L, -2, "resolve");
+    lua_pushnumber(L, timings->times[TIMER_PASS]);
+    lua_setfield(L, -2, "pass");
+    lua_createtable(L, timings->passCount, 0);
+    for (uint32_t i = 0; i < timings->passCount; i++) {
+      lua_pushnumber(L, timings->passes[i]);
+      lua_rawseti(L, -2, i + 1);
+    }
+    lua_setfield(L, -2, "passes");
+  } else {
+    lua_pushnil(L);
+  }
+  lua_setfield(L, 1, "timings");
   return 1;
 }
 
+static int l_lovrGraphicsIsTimingEnabled(lua_State* L) {
+  lua_pushboolean(L, lovrGraphicsIsTimingEnabled());
+  return 1;
+}
+
+static int l_lovrGraphicsSetTimingEnabled(lua_State* L) {
+  lovrGraphicsSetTimingEnabled(lua_toboolean(L, 1));
+  return 0;
+}
+
+static int l_lovrGraphicsPrecompileShaders(lua_State* L) {
+  uint32_t count = 0;
+  Shader** shaders = NULL;
+
+  if (lua_istable(L, 1)) {
+    count = luax_len(L, 1);
+    shaders = malloc(count * sizeof(Shader*));
+    lovrAssert(!count || shaders, "Out of memory");
+    for (uint32_t i = 0; i < count; i++) {
+      lua_rawgeti(L, 1, i + 1);
+      shaders[i] = luax_checktype(L, -1, Shader);
+      lua_pop(L, 1);
+    }
+  }
+
+  lovrGraphicsPrecompileShaders(shaders, count);
+  free(shaders);
+  return 0;
+}
+
 // State
 
 static int l_lovrGraphicsReset(lua_State* L) {
@@ -499,6 +572,16 @@ static int l_lovrGraphicsSetCullingEnabled(lua_State* L) {
   return 0;
 }
 
+static int l_lovrGraphicsIsFrustumCullingEnabled(lua_State* L) {
+  lua_pushboolean(L, lovrGraphicsIsFrustumCullingEnabled());
+  return 1;
+}
+
+static int l_lovrGraphicsSetFrustumCullingEnabled(lua_State* L) {
+  lovrGraphicsSetFrustumCullingEnabled(lua_toboolean(L, 1));
+  return 0;
+}
+
 static int l_lovrGraphicsGetDefaultFilter(lua_State* L) {
   TextureFilter filter = lovrGraphicsGetDefaultFilter();
   lua_pushstring(L, FilterModes[filter.mode]);
@@ -921,6 +1004,21 @@ static int l_lovrGraphicsFill(lua_State* L) {
   return 0;
 }
 
+static int l_lovrGraphicsDrawIndirect(lua_State* L) {
+  Mesh* mesh = luax_checktype(L, 1, Mesh);
+  ShaderBlock* block = luax_checktype(L, 2, ShaderBlock);
+  float transform[16];
+  int index = luax_readmat4(L, 3, transform, 1);
+  lua_Integer count = luaL_optinteger(L, index++, 1);
+  lua_Integer offset = luaL_optinteger(L, index++, 0);
+  lua_Integer stride = luaL_optinteger(L, index++, 0);
+  lovrAssert(count > 0 && count <= UINT32_MAX, "Indirect draw count must be positive");
+  lovrAssert(offset >= 0, "Indirect command offset can not be negative");
+  lovrAssert(stride >= 0 && stride <= UINT32_MAX, "Indirect command stride can not be negative");
+  lovrGraphicsDrawIndirect(mesh, transform, lovrShaderBlockGetBuffer(block), (size_t) offset, (uint32_t) count, (uint32_t) stride);
+  return 0;
+}
+
 static int l_lovrGraphicsCompute(lua_State* L) {
   Shader* shader = luax_checktype(L, 1, Shader);
   int x = luaL_optinteger(L, 2, 1);
@@ -1084,6 +1182,11 @@ static int l_lovrGraphicsNewCanvas(lua_State* L) {
     flags.stereo = lua_isnil(L, -1) ? flags.stereo : lua_toboolean(L, -1);
     lua_pop(L, 1);
 
+    lua_getfield(L, index, "multiview");
+    flags.multiview = lua_toboolean(L, -1);
+    flags.stereo |= flags.multiview;
+    lua_pop(L, 1);
+
     lua_getfield(L, index, "msaa");
     flags.msaa = lua_isnil(L, -1) ? flags.msaa : luaL_checkinteger(L, -1);
     lua_pop(L, 1);
@@ -1100,9 +1203,12 @@ static int l_lovrGraphicsNewCanvas(lua_State* L) {
     }
   }
 
+  // Multiview Canvases render each eye to a layer of an array texture, resolving MSAA implicitly
   if (anonymous) {
-    Texture* texture = lovrTextureCreate(TEXTURE_2D, NULL, 0, true, flags.mipmaps, flags.msaa);
-    lovrTextureAllocate(texture, width, height, 1, format);
+    Texture* texture = flags.multiview ?
+      lovrTextureCreate(TEXTURE_ARRAY, NULL, 0, true, flags.mipmaps, 0) :
+      lovrTextureCreate(TEXTURE_2D, NULL, 0, true, flags.mipmaps, flags.msaa);
+    lovrTextureAllocate(texture, width, height, flags.multiview ? 2 : 1, format);
     lovrTextureSetWrap(texture, (TextureWrap) { .s = WRAP_CLAMP, .t = WRAP_CLAMP, .r = WRAP_CLAMP });
     attachments[0] = (Attachment) { texture, 0, 0 };
     attachmentCount++;
@@ -1335,6 +1441,17 @@ static int l_lovrGraphicsNewModel(lua_State* L) {
   }
 
   Model* model = lovrModelCreate(modelData);
+
+  if (lua_istable(L, 2)) {
+    lua_getfield(L, 2, "lod");
+    if (lua_type(L, -1) == LUA_TNUMBER) {
+      lovrModelGenerateLODs(model, luaL_checkinteger(L, -1));
+    } else if (lua_toboolean(L, -1)) {
+      lovrModelGenerateLODs(model, MAX_LODS);
+    }
+    lua_pop(L, 1);
+  }
+
   luax_pushobject(L, model);
   lovrRelease(ModelData, modelData);
   lovrRelease(Model, model);
@@ -1408,6 +1525,8 @@ static void luax_parseshaderflags(lua_State* L, int index, ShaderFlag flags[MAX_
 static int l_lovrGraphicsNewShader(lua_State* L) {
   ShaderFlag flags[MAX_SHADER_FLAGS];
   uint32_t flagCount = 0;
+  bool multiview = false;
+  bool async = false;
   Shader* shader;
 
   if (lua_isstring(L, 1) && (lua_istable(L, 2) || lua_gettop(L) == 1)) {
@@ -1417,9 +1536,17 @@ static int l_lovrGraphicsNewShader(lua_State* L) {
       lua_getfield(L, 2, "flags");
       luax_parseshaderflags(L, -1, flags, &flagCount);
       lua_pop(L, 1);
+
+      lua_getfield(L, 2, "multiview");
+      multiview = lua_toboolean(L, -1);
+      lua_pop(L, 1);
+
+      lua_getfield(L, 2, "async");
+      async = lua_toboolean(L, -1);
+      lua_pop(L, 1);
     }
 
-    shader = lovrShaderCreateDefault(shaderType, flags, flagCount);
+    shader = lovrShaderCreateDefault(shaderType, flags, flagCount, multiview, async);
   } else {
     luax_readshadersource(L, 1);
     luax_readshadersource(L, 2);
@@ -1430,9 +1557,17 @@ static int l_lovrGraphicsNewShader(lua_State* L) {
       lua_getfield(L, 3, "flags");
       luax_parseshaderflags(L, -1, flags, &flagCount);
       lua_pop(L, 1);
+
+      lua_getfield(L, 3, "multiview");
+      multiview = lua_toboolean(L, -1);
+      lua_pop(L, 1);
+
+      lua_getfield(L, 3, "async");
+      async = lua_toboolean(L, -1);
+      lua_pop(L, 1);
     }
 
-    shader = lovrShaderCreateGraphics(vertexSource, fragmentSource, flags, flagCount);
+    shader = lovrShaderCreateGraphics(vertexSource, fragmentSource, flags, flagCount, multiview, async);
   }
 
   luax_pushobject(L, shader);
@@ -1557,6 +1692,9 @@ static const luaL_Reg lovrGraphics[] = {
   { "getFeatures", l_lovrGraphicsGetFeatures },
   { "getLimits", l_lovrGraphicsGetLimits },
   { "getStats", l_lovrGraphicsGetStats },
+  { "isTimingEnabled", l_lovrGraphicsIsTimingEnabled },
+  { "setTimingEnabled", l_lovrGraphicsSetTimingEnabled },
+  { "precompileShaders", l_lovrGraphicsPrecompileShaders },
 
   // State
   { "reset", l_lovrGraphicsReset },
@@ -1572,6 +1710,8 @@ static const luaL_Reg lovrGraphics[] = {
   { "setColor", l_lovrGraphicsSetColor },
   { "isCullingEnabled", l_lovrGraphicsIsCullingEnabled },
   { "setCullingEnabled", l_lovrGraphicsSetCullingEnabled },
+  { "isFrustumCullingEnabled", l_lovrGraphicsIsFrustumCullingEnabled },
+  { "setFrustumCullingEnabled", l_lovrGraphicsSetFrustumCullingEnabled },
   { "getDefaultFilter", l_lovrGraphicsGetDefaultFilter },
   { "setDefaultFilter", l_lovrGraphicsSetDefaultFilter },
   { "getDepthTest", l_lovrGraphicsGetDepthTest },
@@ -1619,6 +1759,7 @@ static const luaL_Reg lovrGraphics[] = {
   { "print", l_lovrGraphicsPrint },
   { "stencil", l_lovrGraphicsStencil },
   { "fill", l_lovrGraphicsFill },
+  { "drawIndirect", l_lovrGraphicsDrawIndirect },
   { "compute", l_lovrGraphicsCompute },
 
   // Types
@@ -6,6 +6,23 @@
 #include "data/blob.h"
 #include <limits.h>
 
+// Reads a Blob of mat4 instance transforms and an optional Blob of rgba instance colors
+uint32_t luax_readinstances(lua_State* L, int index, float** transforms, float** colors) {
+  Blob* blob = luax_checktype(L, index, Blob);
+  uint32_t count = blob->size / (16 * sizeof(float));
+  lovrAssert(count > 0, "Instance transform Blob must contain at least one mat4");
+  *transforms = blob->data;
+  *colors = NULL;
+
+  if (!lua_isnoneornil(L, index + 1)) {
+    Blob* colorBlob = luax_checktype(L, index + 1, Blob);
+    lovrAssert(colorBlob->size >= count * 4 * sizeof(float), "Instance color Blob must contain 4 floats for each of the %d instances", count);
+    *colors = colorBlob->data;
+  }
+
+  return count;
+}
+
 static int l_lovrMeshAttachAttributes(lua_State* L) {
   Mesh* mesh = luax_checktype(L, 1, Mesh);
   Mesh* other = luax_checktype(L, 2, Mesh);
@@ -99,6 +116,36 @@ static int l_lovrMeshDraw(lua_State* L) {
   return 0;
 }
 
+static int l_lovrMeshDrawInstanced(lua_State* L) {
+  Mesh* mesh = luax_checktype(L, 1, Mesh);
+  float* transforms;
+  float* colors;
+  uint32_t count = luax_readinstances(L, 2, &transforms, &colors);
+  uint32_t vertexCount = lovrMeshGetVertexCount(mesh);
+  uint32_t indexCount = lovrMeshGetIndexCount(mesh);
+  uint32_t defaultCount = indexCount > 0 ? indexCount : vertexCount;
+  uint32_t rangeStart, rangeCount;
+  lovrMeshGetDrawRange(mesh, &rangeStart, &rangeCount);
+  for (uint32_t offset = 0; offset < count; offset += MAX_INSTANCES) {
+    uint32_t chunk = MIN(count - offset, MAX_INSTANCES);
+    lovrGraphicsBatch(&(BatchRequest) {
+      .type = BATCH_MESH,
+      .params.mesh = {
+        .object = mesh,
+        .mode = lovrMeshGetDrawMode(mesh),
+        .rangeStart = rangeStart,
+        .rangeCount = rangeCount ? rangeCount : defaultCount,
+        .instances = chunk,
+        .instanceData = true,
+        .instanceStart = lovrGraphicsWriteInstances(transforms + 16 * offset, colors ? colors + 4 * offset : NULL, chunk)
+      },
+      .drawMode = lovrMeshGetDrawMode(mesh),
+      .material = lovrMeshGetMaterial(mesh)
+    });
+  }
+  return 0;
+}
+
 static int l_lovrMeshGetDrawMode(lua_State* L) {
   Mesh* mesh = luax_checktype(L, 1, Mesh);
   lua_pushstring(L, DrawModes[lovrMeshGetDrawMode(mesh)]);
@@ -504,6 +551,7 @@ const luaL_Reg lovrMesh[] = {
   { "attachAttributes", l_lovrMeshAttachAttributes },
   { "detachAttributes", l_lovrMeshDetachAttributes },
   { "draw", l_lovrMeshDraw },
+  { "drawInstanced", l_lovrMeshDrawInstanced },
   { "getVertexFormat", l_lovrMeshGetVertexFormat },
   { "getVertexCount", l_lovrMeshGetVertexCount },
   { "getVertex", l_lovrMeshGetVertex },
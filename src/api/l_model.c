@@ -12,6 +12,21 @@ static int l_lovrModelDraw(lua_State* L) {
   return 0;
 }
 
+static int l_lovrModelDrawInstanced(lua_State* L) {
+  Model* model = luax_checktype(L, 1, Model);
+  float* transforms;
+  float* colors;
+  uint32_t count = luax_readinstances(L, 2, &transforms, &colors);
+  lovrModelDrawInstanced(model, transforms, colors, count);
+  return 0;
+}
+
+static int l_lovrModelGetLODCount(lua_State* L) {
+  Model* model = luax_checktype(L, 1, Model);
+  lua_pushinteger(L, lovrModelGetLODCount(model));
+  return 1;
+}
+
 static int l_lovrModelGetAnimator(lua_State* L) {
   Model* model = luax_checktype(L, 1, Model);
   luax_pushobject(L, lovrModelGetAnimator(model));
@@ -59,10 +74,12 @@ static int l_lovrModelGetAABB(lua_State* L) {
 
 const luaL_Reg lovrModel[] = {
   { "draw", l_lovrModelDraw },
+  { "drawInstanced", l_lovrModelDrawInstanced },
   { "getAnimator", l_lovrModelGetAnimator },
   { "setAnimator", l_lovrModelSetAnimator },
   { "getMaterial", l_lovrModelGetMaterial },
   { "setMaterial", l_lovrModelSetMaterial },
   { "getAABB", l_lovrModelGetAABB },
+  { "getLODCount", l_lovrModelGetLODCount },
   { NULL, NULL }
 };
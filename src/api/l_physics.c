@@ -1,11 +1,42 @@
 #include "api.h"
 #include "physics/physics.h"
+#include "data/blob.h"
+#include "data/modelData.h"
+#include "data/textureData.h"
+#include <stdlib.h>
+#include <string.h>
+
+const char* BroadphaseTypes[] = {
+  [BROADPHASE_HASH] = "hash",
+  [BROADPHASE_SAP] = "sap",
+  [BROADPHASE_QUADTREE] = "quadtree",
+  [BROADPHASE_SIMPLE] = "simple",
+  NULL
+};
+
+static const char* axisOrders[] = { "xyz", "xzy", "yxz", "yzx", "zxy", "zyx", NULL };
+static const int axisOrderValues[] = { dSAP_AXES_XYZ, dSAP_AXES_XZY, dSAP_AXES_YXZ, dSAP_AXES_YZX, dSAP_AXES_ZXY, dSAP_AXES_ZYX };
 
 const char* ShapeTypes[] = {
   [SHAPE_SPHERE] = "sphere",
   [SHAPE_BOX] = "box",
   [SHAPE_CAPSULE] = "capsule",
   [SHAPE_CYLINDER] = "cylinder",
+  [SHAPE_MESH] = "mesh",
+  [SHAPE_TERRAIN] = "terrain",
+  NULL
+};
+
+const char* RaycastModes[] = {
+  [RAYCAST_ALL] = "all",
+  [RAYCAST_CLOSEST] = "closest",
+  [RAYCAST_ANY] = "any",
+  NULL
+};
+
+const char* PoseFormats[] = {
+  [POSE_STATE] = "state",
+  [POSE_MATRIX] = "mat4",
   NULL
 };
 
@@ -17,6 +48,55 @@ const char* JointTypes[] = {
   NULL
 };
 
+static void readVec3(lua_State* L, int index, const char* field, float* v, float x, float y, float z) {
+  lua_getfield(L, index, field);
+  if (lua_isnil(L, -1)) {
+    v[0] = x, v[1] = y, v[2] = z;
+  } else {
+    luaL_checktype(L, -1, LUA_TTABLE);
+    for (int i = 0; i < 3; i++) {
+      lua_rawgeti(L, -1, i + 1);
+      v[i] = luax_checkfloat(L, -1);
+      lua_pop(L, 1);
+    }
+  }
+  lua_pop(L, 1);
+}
+
+static void readBroadphase(lua_State* L, int index, BroadphaseInfo* info) {
+  lua_getfield(L, index, "broadphase");
+  info->type = luaL_checkoption(L, -1, "hash", BroadphaseTypes);
+  lua_pop(L, 1);
+
+  lua_getfield(L, index, "static");
+  info->splitStatic = lua_toboolean(L, -1);
+  lua_pop(L, 1);
+
+  lua_getfield(L, index, "levels");
+  if (lua_istable(L, -1)) {
+    lua_rawgeti(L, -1, 1);
+    lua_rawgeti(L, -2, 2);
+    info->minLevel = luaL_checkinteger(L, -2);
+    info->maxLevel = luaL_checkinteger(L, -1);
+    lua_pop(L, 2);
+  } else {
+    info->minLevel = -4;
+    info->maxLevel = 8;
+  }
+  lua_pop(L, 1);
+
+  lua_getfield(L, index, "axes");
+  info->axisOrder = axisOrderValues[luaL_checkoption(L, -1, "xzy", axisOrders)];
+  lua_pop(L, 1);
+
+  readVec3(L, index, "center", info->center, 0.f, 0.f, 0.f);
+  readVec3(L, index, "extents", info->extents, 100.f, 100.f, 100.f);
+
+  lua_getfield(L, index, "depth");
+  info->depth = luaL_optinteger(L, -1, 6);
+  lua_pop(L, 1);
+}
+
 static int l_lovrPhysicsNewWorld(lua_State* L) {
   float xg = luax_optfloat(L, 1, 0.f);
   float yg = luax_optfloat(L, 2, -9.81f);
@@ -27,7 +107,7 @@ static int l_lovrPhysicsNewWorld(lua_State* L) {
   if (lua_type(L, 5) == LUA_TTABLE) {
     tagCount = luax_len(L, 5);
     for (int i = 0; i < tagCount; i++) {
-      lua_rawgeti(L, -1, i + 1);
+      lua_rawgeti(L, 5, i + 1);
       if (lua_isstring(L, -1)) {
         tags[i] = lua_tostring(L, -1);
       } else {
@@ -38,12 +118,44 @@ static int l_lovrPhysicsNewWorld(lua_State* L) {
   } else {
     tagCount = 0;
   }
-  World* world = lovrWorldCreate(xg, yg, zg, allowSleep, tags, tagCount);
+  BroadphaseInfo broadphase;
+  bool hasBroadphase = lua_istable(L, 6);
+  if (hasBroadphase) {
+    readBroadphase(L, 6, &broadphase);
+  }
+  World* world = lovrWorldCreate(xg, yg, zg, allowSleep, tags, tagCount, hasBroadphase ? &broadphase : NULL);
   luax_pushobject(L, world);
   lovrRelease(World, world);
   return 1;
 }
 
+static int l_lovrPhysicsGetWorkerCount(lua_State* L) {
+  lua_pushinteger(L, lovrPhysicsGetWorkerCount());
+  return 1;
+}
+
+static int l_lovrPhysicsSetWorkerCount(lua_State* L) {
+  int count = luaL_checkinteger(L, 1);
+  lovrAssert(count >= 0, "Worker count must not be negative");
+  lovrPhysicsSetWorkerCount(count);
+  return 0;
+}
+
+static int l_lovrPhysicsUpdate(lua_State* L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  float dt = luax_checkfloat(L, 2);
+  World* worlds[64];
+  int count = luax_len(L, 1);
+  lovrAssert(count <= (int) (sizeof(worlds) / sizeof(worlds[0])), "Too many Worlds (max is %d)", (int) (sizeof(worlds) / sizeof(worlds[0])));
+  for (int i = 0; i < count; i++) {
+    lua_rawgeti(L, 1, i + 1);
+    worlds[i] = luax_checktype(L, -1, World);
+    lua_pop(L, 1);
+  }
+  lovrPhysicsUpdateWorlds(worlds, count, dt);
+  return 0;
+}
+
 static int l_lovrPhysicsNewBallJoint(lua_State* L) {
   Collider* a = luax_checktype(L, 1, Collider);
   Collider* b = luax_checktype(L, 2, Collider);
@@ -84,6 +196,175 @@ static int l_lovrPhysicsNewCylinderShape(lua_State* L) {
   return 1;
 }
 
+// Accepts a vertex list and an index list (tables or Blobs of floats/uint32s), a ModelData and an
+// optional node index, or a Blob previously returned by MeshShape:serialize.
+Shape* luax_newmeshshape(lua_State* L, int index) {
+  ModelData* modelData = luax_totype(L, index, ModelData);
+  if (modelData) {
+    uint32_t node = luaL_optinteger(L, index + 1, 1) - 1;
+    return lovrMeshShapeCreateFromModelData(modelData, node);
+  }
+
+  Blob* blob = luax_totype(L, index, Blob);
+  if (blob && lua_isnoneornil(L, index + 1)) {
+    return lovrMeshShapeCreateFromCache(blob->data, blob->size);
+  }
+
+  // Everything that can raise a Lua error is checked before the buffers are allocated, so an invalid
+  // argument does not leak them
+  uint32_t vertexCount, indexCount;
+  if (blob) {
+    lovrAssert(blob->size % (3 * sizeof(float)) == 0, "Vertex Blob size must be a multiple of 12 bytes");
+    vertexCount = blob->size / (3 * sizeof(float));
+  } else {
+    luaL_checktype(L, index, LUA_TTABLE);
+    uint32_t length = luax_len(L, index);
+    lovrAssert(length % 3 == 0, "Vertex table length must be a multiple of 3");
+    for (uint32_t i = 0; i < length; i++) {
+      lua_rawgeti(L, index, i + 1);
+      luax_checkfloat(L, -1);
+      lua_pop(L, 1);
+    }
+    vertexCount = length / 3;
+  }
+
+  Blob* indexBlob = luax_totype(L, index + 1, Blob);
+  if (indexBlob) {
+    lovrAssert(indexBlob->size % sizeof(uint32_t) == 0, "Index Blob size must be a multiple of 4 bytes");
+    indexCount = indexBlob->size / sizeof(uint32_t);
+  } else {
+    luaL_checktype(L, index + 1, LUA_TTABLE);
+    indexCount = luax_len(L, index + 1);
+    for (uint32_t i = 0; i < indexCount; i++) {
+      lua_rawgeti(L, index + 1, i + 1);
+      luaL_checkinteger(L, -1);
+      lua_pop(L, 1);
+    }
+  }
+
+  float* vertices = malloc(3 * vertexCount * sizeof(float));
+  uint32_t* indices = malloc(indexCount * sizeof(uint32_t));
+  if (!vertices || !indices) {
+    free(vertices);
+    free(indices);
+    lovrThrow("Out of memory");
+  }
+
+  if (blob) {
+    memcpy(vertices, blob->data, blob->size);
+  } else {
+    for (uint32_t i = 0; i < 3 * vertexCount; i++) {
+      lua_rawgeti(L, index, i + 1);
+      vertices[i] = lua_tonumber(L, -1);
+      lua_pop(L, 1);
+    }
+  }
+
+  if (indexBlob) {
+    memcpy(indices, indexBlob->data, indexBlob->size);
+  } else {
+    for (uint32_t i = 0; i < indexCount; i++) {
+      lua_rawgeti(L, index + 1, i + 1);
+      indices[i] = lua_tointeger(L, -1) - 1;
+      lua_pop(L, 1);
+    }
+  }
+
+  return lovrMeshShapeCreate(vertices, vertexCount, indices, indexCount);
+}
+
+// Checks that a Blob or table at index holds a columns x rows grid of heights and returns the number
+// of heights.  Everything that can raise an error happens here, before the heights are allocated.
+uint32_t luax_checkheights(lua_State* L, int index, uint32_t columns, uint32_t rows) {
+  lovrAssert(columns > 0 && rows > 0, "Height sample count must be positive");
+  lovrAssert(columns <= UINT32_MAX / rows && columns * rows <= SIZE_MAX / sizeof(float), "Too many heights");
+  uint32_t count = columns * rows;
+  Blob* blob = luax_totype(L, index, Blob);
+  if (blob) {
+    lovrAssert(blob->size / sizeof(float) >= count, "Blob is too small to hold %d heights", count);
+  } else {
+    luaL_checktype(L, index, LUA_TTABLE);
+    lovrAssert((uint32_t) luax_len(L, index) >= count, "Expected %d heights", count);
+    for (uint32_t i = 0; i < count; i++) {
+      lua_rawgeti(L, index, i + 1);
+      luax_checkfloat(L, -1);
+      lua_pop(L, 1);
+    }
+  }
+  return count;
+}
+
+// Copies heights that were already validated with luax_checkheights
+void luax_readheights(lua_State* L, int index, float* heights, uint32_t count) {
+  Blob* blob = luax_totype(L, index, Blob);
+  if (blob) {
+    memcpy(heights, blob->data, count * sizeof(float));
+  } else {
+    for (uint32_t i = 0; i < count; i++) {
+      lua_rawgeti(L, index, i + 1);
+      heights[i] = lua_tonumber(L, -1);
+      lua_pop(L, 1);
+    }
+  }
+}
+
+// Accepts a TextureData (the red channel is the height) or a table/Blob of heights followed by the
+// number of columns and rows, then the size of the terrain and a vertical scale.
+Shape* luax_newterrainshape(lua_State* L, int index) {
+  uint32_t columns, rows;
+  int heightIndex = index;
+
+  TextureData* textureData = luax_totype(L, index, TextureData);
+  if (textureData) {
+    columns = textureData->width;
+    rows = textureData->height;
+    lovrAssert(columns >= 2 && rows >= 2, "Terrain must have at least 2x2 samples");
+    lovrAssert(columns <= UINT32_MAX / rows && columns * rows <= SIZE_MAX / sizeof(float), "Too many heights");
+    index++;
+  } else {
+    lua_Integer c = luaL_checkinteger(L, index + 1);
+    lua_Integer r = luaL_checkinteger(L, index + 2);
+    lovrAssert(c >= 2 && r >= 2 && c <= UINT32_MAX && r <= UINT32_MAX, "Terrain must have at least 2x2 samples");
+    columns = (uint32_t) c;
+    rows = (uint32_t) r;
+    luax_checkheights(L, heightIndex, columns, rows);
+    index += 3;
+  }
+
+  float width = luax_optfloat(L, index++, columns - 1.f);
+  float depth = luax_optfloat(L, index++, rows - 1.f);
+  float scale = luax_optfloat(L, index++, 1.f);
+
+  float* heights = malloc(columns * rows * sizeof(float));
+  lovrAssert(heights, "Out of memory");
+
+  if (textureData) {
+    for (uint32_t y = 0; y < rows; y++) {
+      for (uint32_t x = 0; x < columns; x++) {
+        heights[y * columns + x] = lovrTextureDataGetPixel(textureData, x, y).r;
+      }
+    }
+  } else {
+    luax_readheights(L, heightIndex, heights, columns * rows);
+  }
+
+  return lovrTerrainShapeCreate(heights, columns, rows, width, depth, scale);
+}
+
+static int l_lovrPhysicsNewTerrainShape(lua_State* L) {
+  TerrainShape* terrain = luax_newterrainshape(L, 1);
+  luax_pushobject(L, terrain);
+  lovrRelease(Shape, terrain);
+  return 1;
+}
+
+static int l_lovrPhysicsNewMeshShape(lua_State* L) {
+  MeshShape* mesh = luax_newmeshshape(L, 1);
+  luax_pushobject(L, mesh);
+  lovrRelease(Shape, mesh);
+  return 1;
+}
+
 static int l_lovrPhysicsNewDistanceJoint(lua_State* L) {
   Collider* a = luax_checktype(L, 1, Collider);
   Collider* b = luax_checktype(L, 2, Collider);
@@ -136,10 +417,15 @@ static int l_lovrPhysicsNewSphereShape(lua_State* L) {
 
 static const luaL_Reg lovrPhysics[] = {
   { "newWorld", l_lovrPhysicsNewWorld },
+  { "getWorkerCount", l_lovrPhysicsGetWorkerCount },
+  { "setWorkerCount", l_lovrPhysicsSetWorkerCount },
+  { "update", l_lovrPhysicsUpdate },
   { "newBallJoint", l_lovrPhysicsNewBallJoint },
   { "newBoxShape", l_lovrPhysicsNewBoxShape },
   { "newCapsuleShape", l_lovrPhysicsNewCapsuleShape },
   { "newCylinderShape", l_lovrPhysicsNewCylinderShape },
+  { "newMeshShape", l_lovrPhysicsNewMeshShape },
+  { "newTerrainShape", l_lovrPhysicsNewTerrainShape },
   { "newDistanceJoint", l_lovrPhysicsNewDistanceJoint },
   { "newHingeJoint", l_lovrPhysicsNewHingeJoint },
   { "newSliderJoint", l_lovrPhysicsNewSliderJoint },
@@ -160,8 +446,12 @@ int luaopen_lovr_physics(lua_State* L) {
   luax_extendtype(L, Shape, BoxShape);
   luax_extendtype(L, Shape, CapsuleShape);
   luax_extendtype(L, Shape, CylinderShape);
+  luax_extendtype(L, Shape, MeshShape);
+  luax_extendtype(L, Shape, TerrainShape);
   if (lovrPhysicsInit()) {
     luax_atexit(L, lovrPhysicsDestroy);
+  } else {
+    luax_atexit(L, lovrPhysicsDestroyThread);
   }
   return 1;
 }
@@ -188,6 +188,12 @@ static int l_lovrShaderGetType(lua_State* L) {
   return 1;
 }
 
+static int l_lovrShaderIsReady(lua_State* L) {
+  Shader* shader = luax_checktype(L, 1, Shader);
+  lua_pushboolean(L, lovrShaderIsReady(shader));
+  return 1;
+}
+
 static int l_lovrShaderHasUniform(lua_State* L) {
   Shader* shader = luax_checktype(L, 1, Shader);
   const char* name = luaL_checkstring(L, 2);
@@ -248,6 +254,7 @@ static int l_lovrShaderSendImage(lua_State* L) {
 
 const luaL_Reg lovrShader[] = {
   { "getType", l_lovrShaderGetType },
+  { "isReady", l_lovrShaderIsReady },
   { "hasUniform", l_lovrShaderHasUniform },
   { "send", l_lovrShaderSend },
   { "sendBlock", l_lovrShaderSendBlock },
@@ -1,5 +1,7 @@
 #include "api.h"
 #include "physics/physics.h"
+#include "data/blob.h"
+#include <stdlib.h>
 
 static int l_lovrShapeDestroy(lua_State* L) {
   Shape* shape = luax_checktype(L, 1, Shape);
@@ -252,3 +254,90 @@ const luaL_Reg lovrCylinderShape[] = {
   { "setLength", l_lovrCylinderShapeSetLength },
   { NULL, NULL }
 };
+
+static int l_lovrMeshShapeGetVertexCount(lua_State* L) {
+  MeshShape* mesh = luax_checktype(L, 1, MeshShape);
+  lua_pushinteger(L, lovrMeshShapeGetVertexCount(mesh));
+  return 1;
+}
+
+static int l_lovrMeshShapeGetTriangleCount(lua_State* L) {
+  MeshShape* mesh = luax_checktype(L, 1, MeshShape);
+  lua_pushinteger(L, lovrMeshShapeGetTriangleCount(mesh));
+  return 1;
+}
+
+static int l_lovrMeshShapeSerialize(lua_State* L) {
+  MeshShape* mesh = luax_checktype(L, 1, MeshShape);
+  size_t size;
+  void* data = lovrMeshShapeSerialize(mesh, &size);
+  Blob* blob = lovrBlobCreate(data, size, "Mesh shape");
+  luax_pushobject(L, blob);
+  lovrRelease(Blob, blob);
+  return 1;
+}
+
+const luaL_Reg lovrMeshShape[] = {
+  { "getVertexCount", l_lovrMeshShapeGetVertexCount },
+  { "getTriangleCount", l_lovrMeshShapeGetTriangleCount },
+  { "serialize", l_lovrMeshShapeSerialize },
+  { NULL, NULL }
+};
+
+static int l_lovrTerrainShapeGetSampleCount(lua_State* L) {
+  TerrainShape* terrain = luax_checktype(L, 1, TerrainShape);
+  uint32_t columns, rows;
+  lovrTerrainShapeGetSampleCount(terrain, &columns, &rows);
+  lua_pushinteger(L, columns);
+  lua_pushinteger(L, rows);
+  return 2;
+}
+
+static int l_lovrTerrainShapeGetDimensions(lua_State* L) {
+  TerrainShape* terrain = luax_checktype(L, 1, TerrainShape);
+  float width, depth;
+  lovrTerrainShapeGetDimensions(terrain, &width, &depth);
+  lua_pushnumber(L, width);
+  lua_pushnumber(L, depth);
+  return 2;
+}
+
+static int l_lovrTerrainShapeGetHeight(lua_State* L) {
+  TerrainShape* terrain = luax_checktype(L, 1, TerrainShape);
+  uint32_t column = luaL_checkinteger(L, 2) - 1;
+  uint32_t row = luaL_checkinteger(L, 3) - 1;
+  lua_pushnumber(L, lovrTerrainShapeGetHeight(terrain, column, row));
+  return 1;
+}
+
+static int l_lovrTerrainShapeSetHeights(lua_State* L) {
+  TerrainShape* terrain = luax_checktype(L, 1, TerrainShape);
+  lua_Integer c = luaL_checkinteger(L, 2);
+  lua_Integer r = luaL_checkinteger(L, 3);
+  lua_Integer w = luaL_checkinteger(L, 4);
+  lua_Integer h = luaL_checkinteger(L, 5);
+  uint32_t totalColumns, totalRows;
+  lovrTerrainShapeGetSampleCount(terrain, &totalColumns, &totalRows);
+  lovrAssert(c >= 1 && r >= 1 && w >= 1 && h >= 1, "Terrain region must start at 1 and cover at least one sample");
+  lovrAssert(c <= totalColumns && w <= totalColumns - (c - 1), "Terrain region is out of range");
+  lovrAssert(r <= totalRows && h <= totalRows - (r - 1), "Terrain region is out of range");
+  uint32_t column = (uint32_t) c - 1;
+  uint32_t row = (uint32_t) r - 1;
+  uint32_t columns = (uint32_t) w;
+  uint32_t rows = (uint32_t) h;
+  uint32_t count = luax_checkheights(L, 6, columns, rows);
+  float* heights = malloc(count * sizeof(float));
+  lovrAssert(heights, "Out of memory");
+  luax_readheights(L, 6, heights, count);
+  lovrTerrainShapeSetHeights(terrain, column, row, columns, rows, heights);
+  free(heights);
+  return 0;
+}
+
+const luaL_Reg lovrTerrainShape[] = {
+  { "getSampleCount", l_lovrTerrainShapeGetSampleCount },
+  { "getDimensions", l_lovrTerrainShapeGetDimensions },
+  { "getHeight", l_lovrTerrainShapeGetHeight },
+  { "setHeights", l_lovrTerrainShapeSetHeights },
+  { NULL, NULL }
+};
@@ -3,6 +3,7 @@
 #include "filesystem/filesystem.h"
 #include "thread/thread.h"
 #include "thread/channel.h"
+#include "core/profiler.h"
 
 static int threadRunner(void* data) {
   Thread* thread = (Thread*) data;
@@ -38,10 +39,12 @@ static int threadRunner(void* data) {
       .data.thread = { thread, strdup(thread->error) }
     });
     lua_close(L);
+    LOVR_ZONE_RELEASE_THREAD();
     return 1;
   }
 
   lua_close(L);
+  LOVR_ZONE_RELEASE_THREAD();
   return 0;
 }
 
@@ -1,5 +1,21 @@
 #include "api.h"
 #include "timer/timer.h"
+#include "core/profiler.h"
+#include <stdlib.h>
+
+const char* PacingModes[] = {
+  [PACING_NONE] = "none",
+  [PACING_SLEEP] = "sleep",
+  [PACING_FPS] = "fps",
+  [PACING_COMPOSITOR] = "compositor",
+  NULL
+};
+
+const char* ProfileFormats[] = {
+  [PROFILE_CHROME] = "chrome",
+  [PROFILE_BINARY] = "binary",
+  NULL
+};
 
 static int l_lovrTimerGetDelta(lua_State* L) {
   lua_pushnumber(L, lovrTimerGetDelta());
@@ -32,6 +48,109 @@ static int l_lovrTimerSleep(lua_State* L) {
   return 0;
 }
 
+static int l_lovrTimerGetSampleCount(lua_State* L) {
+  lua_pushinteger(L, lovrTimerGetSampleCount());
+  return 1;
+}
+
+static int l_lovrTimerSetSampleCount(lua_State* L) {
+  lua_Integer count = luaL_checkinteger(L, 1);
+  luaL_argcheck(L, count > 0, 1, "Sample count must be positive");
+  lovrTimerSetSampleCount((uint32_t) count);
+  return 0;
+}
+
+static int l_lovrTimerGetSamples(lua_State* L) {
+  uint32_t count = lovrTimerGetSampleCount();
+  double* samples = malloc(count * sizeof(double));
+  lovrAssert(samples, "Out of memory");
+  count = lovrTimerGetSamples(samples, count);
+  lua_createtable(L, count, 0);
+  for (uint32_t i = 0; i < count; i++) {
+    lua_pushnumber(L, samples[i]);
+    lua_rawseti(L, -2, i + 1);
+  }
+  free(samples);
+  return 1;
+}
+
+static int l_lovrTimerGetStats(lua_State* L) {
+  double fps;
+  lovrTimerGetPacing(&fps);
+  fps = luaL_optnumber(L, 1, fps);
+  luaL_argcheck(L, fps > 0., 1, "Target frame rate must be positive");
+
+  if (lua_gettop(L) > 1) {
+    luaL_checktype(L, 2, LUA_TTABLE);
+    lua_settop(L, 2);
+  } else {
+    lua_createtable(L, 0, 7);
+  }
+
+  FrameStats stats;
+  lovrTimerGetStats(&stats, fps);
+  lua_pushinteger(L, stats.count);
+  lua_setfield(L, -2, "count");
+  lua_pushinteger(L, stats.dropped);
+  lua_setfield(L, -2, "dropped");
+  lua_pushnumber(L, stats.min);
+  lua_setfield(L, -2, "min");
+  lua_pushnumber(L, stats.max);
+  lua_setfield(L, -2, "max");
+  lua_pushnumber(L, stats.p50);
+  lua_setfield(L, -2, "p50");
+  lua_pushnumber(L, stats.p95);
+  lua_setfield(L, -2, "p95");
+  lua_pushnumber(L, stats.p99);
+  lua_setfield(L, -2, "p99");
+  return 1;
+}
+
+static int l_lovrTimerBeginZone(lua_State* L) {
+  const char* name = luaL_checkstring(L, 1);
+  LOVR_ZONE_BEGIN(name);
+  return 0;
+}
+
+static int l_lovrTimerEndZone(lua_State* L) {
+  LOVR_ZONE_END();
+  return 0;
+}
+
+static int l_lovrTimerExportTrace(lua_State* L) {
+#ifdef LOVR_ENABLE_PROFILER
+  ProfileFormat format = luaL_checkoption(L, 1, "chrome", ProfileFormats);
+  bool clear = lua_toboolean(L, 2);
+  size_t size;
+  void* data = lovrProfilerExport(format, &size);
+  lua_pushlstring(L, data, size);
+  free(data);
+  if (clear) {
+    lovrProfilerClear();
+  }
+  return 1;
+#else
+  lua_pushnil(L);
+  return 1;
+#endif
+}
+
+static int l_lovrTimerGetPacing(lua_State* L) {
+  double fps;
+  PacingMode mode = lovrTimerGetPacing(&fps);
+  lua_pushstring(L, PacingModes[mode]);
+  lua_pushnumber(L, fps);
+  return 2;
+}
+
+static int l_lovrTimerSetPacing(lua_State* L) {
+  double fps;
+  PacingMode mode = luaL_checkoption(L, 1, NULL, PacingModes);
+  lovrTimerGetPacing(&fps);
+  lovrTimerSetPacing(mode, luaL_optnumber(L, 2, fps));
+  return 0;
+}
+
 static const luaL_Reg lovrTimer[] = {
   { "getDelta", l_lovrTimerGetDelta },
   { "getAverageDelta", l_lovrTimerGetAverageDelta },
@@ -39,14 +158,54 @@ static const luaL_Reg lovrTimer[] = {
   { "getTime", l_lovrTimerGetTime },
   { "step", l_lovrTimerStep },
   { "sleep", l_lovrTimerSleep },
+  { "getSampleCount", l_lovrTimerGetSampleCount },
+  { "setSampleCount", l_lovrTimerSetSampleCount },
+  { "getSamples", l_lovrTimerGetSamples },
+  { "getStats", l_lovrTimerGetStats },
+  { "beginZone", l_lovrTimerBeginZone },
+  { "endZone", l_lovrTimerEndZone },
+  { "exportTrace", l_lovrTimerExportTrace },
+  { "getPacing", l_lovrTimerGetPacing },
+  { "setPacing", l_lovrTimerSetPacing },
   { NULL, NULL }
 };
 
 int luaopen_lovr_timer(lua_State* L) {
   lua_newtable(L);
   luaL_register(L, NULL, lovrTimer);
-  if (lovrTimerInit()) {
-    luax_atexit(L, lovrTimerDestroy);
+  if (!lovrTimerInit()) {
+    return 1;
   }
+
+  luax_atexit(L, lovrTimerDestroy);
+
+  // Threads don't have a conf table, and requiring the module again shouldn't reset its settings
+  luax_pushconf(L);
+  if (lua_istable(L, -1)) {
+    lua_getfield(L, -1, "timer");
+    if (lua_istable(L, -1)) {
+      double fps;
+      PacingMode mode = lovrTimerGetPacing(&fps);
+
+      lua_getfield(L, -1, "pacing");
+      mode = luaL_checkoption(L, -1, PacingModes[mode], PacingModes);
+      lua_pop(L, 1);
+
+      lua_getfield(L, -1, "fps");
+      fps = luaL_optnumber(L, -1, fps);
+      lua_pop(L, 1);
+
+      lovrTimerSetPacing(mode, fps);
+
+      lua_getfield(L, -1, "samples");
+      lua_Integer samples = luaL_optinteger(L, -1, lovrTimerGetSampleCount());
+      lovrAssert(samples > 0, "t.timer.samples must be positive");
+      lovrTimerSetSampleCount((uint32_t) samples);
+      lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
+  }
+
+  lua_pop(L, 1);
   return 1;
 }
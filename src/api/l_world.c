@@ -1,7 +1,18 @@
 #include "api.h"
 #include "physics/physics.h"
+#include "core/maf.h"
+#include "data/blob.h"
+#ifdef LOVR_ENABLE_GRAPHICS
+#include "graphics/buffer.h"
+#include "graphics/shader.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 
+#define RAYCAST_HIT_FLOATS 8
+#define CONTACT_FLOATS 8
+
 static void collisionResolver(World* world, void* userdata) {
   lua_State* L = userdata;
   luaL_checktype(L, -1, LUA_TFUNCTION);
@@ -37,6 +48,98 @@ static void raycastCallback(Shape* shape, float x, float y, float z, float nx, f
   lua_call(L, 7, 0);
 }
 
+// Reads a flat float array from a Blob (used in place) or a table of numbers (copied, must be freed)
+static float* readFloats(lua_State* L, int index, uint32_t stride, uint32_t* count, bool* allocated) {
+  Blob* blob = luax_totype(L, index, Blob);
+
+  if (blob) {
+    *count = blob->size / (stride * sizeof(float));
+    *allocated = false;
+    return blob->data;
+  }
+
+  // The numbers are checked before the copy is allocated, so a bad entry doesn't leak it
+  luaL_checktype(L, index, LUA_TTABLE);
+  int length = luax_len(L, index);
+  lovrAssert(length % stride == 0, "Expected a multiple of %d numbers, got %d", stride, length);
+  for (int i = 0; i < length; i++) {
+    lua_rawgeti(L, index, i + 1);
+    luax_checkfloat(L, -1);
+    lua_pop(L, 1);
+  }
+
+  float* data = malloc(length * sizeof(float));
+  lovrAssert(data, "Out of memory");
+  for (int i = 0; i < length; i++) {
+    lua_rawgeti(L, index, i + 1);
+    data[i] = lua_tonumber(L, -1);
+    lua_pop(L, 1);
+  }
+
+  *count = length / stride;
+  *allocated = true;
+  return data;
+}
+
+static uint32_t readTagMask(lua_State* L, int index, World* world) {
+  if (lua_isnoneornil(L, index)) {
+    return ~0u;
+  }
+
+  uint32_t mask = 0;
+  luaL_checktype(L, index, LUA_TTABLE);
+  int length = luax_len(L, index);
+  for (int i = 0; i < length; i++) {
+    lua_rawgeti(L, index, i + 1);
+    const char* name = luaL_checkstring(L, -1);
+    int tag = lovrWorldGetTag(world, name);
+    lovrAssert(tag != NO_TAG, "Unknown tag '%s'", name);
+    mask |= (1 << tag);
+    lua_pop(L, 1);
+  }
+  return mask;
+}
+
+// Checks an optional table of colliders and returns how many there are.  A nil value means all of
+// the colliders in the world.
+static uint32_t checkColliders(lua_State* L, int index, World* world) {
+  if (lua_isnoneornil(L, index)) {
+    return lovrWorldGetColliderCount(world);
+  }
+
+  luaL_checktype(L, index, LUA_TTABLE);
+  uint32_t count = luax_len(L, index);
+  for (uint32_t i = 0; i < count; i++) {
+    lua_rawgeti(L, index, i + 1);
+    Collider* collider = luax_checktype(L, -1, Collider);
+    lovrAssert(collider->world == world, "Collider %d does not belong to this World", i + 1);
+    lua_pop(L, 1);
+  }
+  return count;
+}
+
+// Copies a table of colliders that was already validated with checkColliders.  It doesn't raise
+// errors, so callers can release their own allocations first when it returns false (out of memory).
+// The result is NULL (all colliders, in world order) if the value at index is nil.
+static bool readColliders(lua_State* L, int index, uint32_t count, Collider*** colliders) {
+  *colliders = NULL;
+  if (lua_isnoneornil(L, index)) {
+    return true;
+  }
+
+  *colliders = malloc(MAX(count, 1) * sizeof(Collider*));
+  if (!*colliders) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    lua_rawgeti(L, index, i + 1);
+    (*colliders)[i] = luax_totype(L, -1, Collider);
+    lua_pop(L, 1);
+  }
+  return true;
+}
+
 static int l_lovrWorldNewCollider(lua_State* L) {
   World* world = luax_checktype(L, 1, World);
   float x = luax_optfloat(L, 2, 0.f);
@@ -97,6 +200,29 @@ static int l_lovrWorldNewCylinderCollider(lua_State* L) {
   return 1;
 }
 
+static int l_lovrWorldNewMeshCollider(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  MeshShape* shape = luax_newmeshshape(L, 2);
+  Collider* collider = lovrColliderCreate(world, 0.f, 0.f, 0.f);
+  lovrColliderAddShape(collider, shape);
+  luax_pushobject(L, collider);
+  lovrRelease(Collider, collider);
+  lovrRelease(Shape, shape);
+  return 1;
+}
+
+static int l_lovrWorldNewTerrainCollider(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  TerrainShape* shape = luax_newterrainshape(L, 2);
+  Collider* collider = lovrColliderCreate(world, 0.f, 0.f, 0.f);
+  lovrColliderSetKinematic(collider, true);
+  lovrColliderAddShape(collider, shape);
+  luax_pushobject(L, collider);
+  lovrRelease(Collider, collider);
+  lovrRelease(Shape, shape);
+  return 1;
+}
+
 static int l_lovrWorldNewSphereCollider(lua_State* L) {
   World* world = luax_checktype(L, 1, World);
   float x = luax_optfloat(L, 2, 0.f);
@@ -123,10 +249,68 @@ static int l_lovrWorldUpdate(lua_State* L) {
   World* world = luax_checktype(L, 1, World);
   float dt = luax_checkfloat(L, 2);
   CollisionResolver resolver = lua_type(L, 3) == LUA_TFUNCTION ? collisionResolver : NULL;
-  lovrWorldUpdate(world, dt, resolver, L);
+  uint32_t steps = lovrWorldUpdate(world, dt, resolver, L);
+  lua_pushinteger(L, steps);
+  return 1;
+}
+
+static int l_lovrWorldGetStep(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  float rate;
+  uint32_t maxSubsteps;
+  lovrWorldGetStep(world, &rate, &maxSubsteps);
+  lua_pushnumber(L, rate);
+  lua_pushinteger(L, maxSubsteps);
+  return 2;
+}
+
+static int l_lovrWorldSetStep(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  float rate = lua_isnoneornil(L, 2) ? 0.f : luax_checkfloat(L, 2);
+  uint32_t maxSubsteps = luaL_optinteger(L, 3, 4);
+  lovrAssert(rate >= 0.f, "Step rate must not be negative");
+  lovrAssert(rate == 0.f || maxSubsteps > 0, "Max substeps must be positive");
+  lovrWorldSetStep(world, rate, maxSubsteps);
+  return 0;
+}
+
+static int l_lovrWorldGetStats(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  if (lua_gettop(L) > 1) {
+    luaL_checktype(L, 2, LUA_TTABLE);
+    lua_settop(L, 2);
+  } else {
+    lua_createtable(L, 0, 2);
+  }
+
+  const WorldStats* stats = lovrWorldGetStats(world);
+  lua_pushinteger(L, stats->pairs);
+  lua_setfield(L, -2, "pairs");
+  lua_pushinteger(L, stats->contacts);
+  lua_setfield(L, -2, "contacts");
+  return 1;
+}
+
+static int l_lovrWorldGetThreadCount(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  lua_pushinteger(L, lovrWorldGetThreadCount(world));
+  return 1;
+}
+
+static int l_lovrWorldSetThreadCount(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  int count = luaL_checkinteger(L, 2);
+  lovrAssert(count > 0, "Thread count must be positive");
+  lovrWorldSetThreadCount(world, count);
   return 0;
 }
 
+static int l_lovrWorldGetInterpolation(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  lua_pushnumber(L, lovrWorldGetInterpolation(world));
+  return 1;
+}
+
 static int l_lovrWorldComputeOverlaps(lua_State* L) {
   World* world = luax_checktype(L, 1, World);
   lovrWorldComputeOverlaps(world);
@@ -140,6 +324,111 @@ static int l_lovrWorldOverlaps(lua_State* L) {
   return 1;
 }
 
+// Writes shapes into the table at index (or a new table), clearing any leftover entries, and pushes
+// the table followed by the count
+static int pushShapes(lua_State* L, int index, Shape** shapes, uint32_t count, uint32_t stride) {
+  if (lua_istable(L, index)) {
+    lua_pushvalue(L, index);
+  } else {
+    lua_createtable(L, count * stride, 0);
+  }
+
+  for (uint32_t i = 0; i < count * stride; i++) {
+    luax_pushobject(L, shapes[i]);
+    lua_rawseti(L, -2, i + 1);
+  }
+
+  int length = luax_len(L, -1);
+  for (int i = count * stride + 1; i <= length; i++) {
+    lua_pushnil(L);
+    lua_rawseti(L, -2, i);
+  }
+
+  lua_pushinteger(L, count);
+  return 2;
+}
+
+static int l_lovrWorldGetOverlaps(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  uint32_t count;
+  Shape** pairs = lovrWorldGetOverlaps(world, &count);
+  return pushShapes(L, 2, pairs, count, 2);
+}
+
+#define QUERY_STACK_SIZE 64
+
+typedef struct {
+  enum { QUERY_AABB, QUERY_BOX, QUERY_SPHERE } type;
+  float position[3];
+  float orientation[4];
+  float size[6];
+} Query;
+
+static uint32_t runQuery(World* world, Query* query, uint32_t tagMask, Shape** shapes, uint32_t capacity) {
+  switch (query->type) {
+    case QUERY_AABB: return lovrWorldQueryAABB(world, query->size, tagMask, shapes, capacity);
+    case QUERY_BOX: return lovrWorldQueryBox(world, query->position, query->orientation, query->size, tagMask, shapes, capacity);
+    case QUERY_SPHERE: return lovrWorldQuerySphere(world, query->position, query->size[0], tagMask, shapes, capacity);
+    default: lovrThrow("Unreachable");
+  }
+}
+
+// Most queries fit on the stack, larger ones are run again with a buffer of the right size
+static int pushQuery(lua_State* L, World* world, Query* query, int index) {
+  uint32_t tagMask = readTagMask(L, index, world);
+  Shape* stack[QUERY_STACK_SIZE];
+  Shape** shapes = stack;
+  uint32_t count = runQuery(world, query, tagMask, shapes, QUERY_STACK_SIZE);
+
+  if (count > QUERY_STACK_SIZE) {
+    shapes = malloc(count * sizeof(Shape*));
+    lovrAssert(shapes, "Out of memory");
+    runQuery(world, query, tagMask, shapes, count);
+  }
+
+  pushShapes(L, index + 1, shapes, count, 1);
+
+  if (shapes != stack) {
+    free(shapes);
+  }
+
+  return 2;
+}
+
+static int l_lovrWorldQueryAABB(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  Query query = { .type = QUERY_AABB };
+  for (int i = 0; i < 6; i++) {
+    query.size[i] = luax_checkfloat(L, 2 + i);
+  }
+  return pushQuery(L, world, &query, 8);
+}
+
+static int l_lovrWorldQueryBox(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  Query query = { .type = QUERY_BOX };
+  for (int i = 0; i < 3; i++) {
+    query.position[i] = luax_checkfloat(L, 2 + i);
+    query.size[i] = luax_checkfloat(L, 5 + i);
+  }
+  float angle = luax_optfloat(L, 8, 0.f);
+  float ax = luax_optfloat(L, 9, 0.f);
+  float ay = luax_optfloat(L, 10, 1.f);
+  float az = luax_optfloat(L, 11, 0.f);
+  quat_fromAngleAxis(query.orientation, angle, ax, ay, az);
+  return pushQuery(L, world, &query, 12);
+}
+
+static int l_lovrWorldQuerySphere(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  Query query = { .type = QUERY_SPHERE };
+  for (int i = 0; i < 3; i++) {
+    query.position[i] = luax_checkfloat(L, 2 + i);
+  }
+  query.size[0] = luax_checkfloat(L, 5);
+  return pushQuery(L, world, &query, 6);
+}
+
 static int l_lovrWorldCollide(lua_State* L) {
   World* world = luax_checktype(L, 1, World);
   Shape* a = luax_checktype(L, 2, Shape);
@@ -230,6 +519,319 @@ static int l_lovrWorldRaycast(lua_State* L) {
   return 0;
 }
 
+static int l_lovrWorldRaycastBatch(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  RaycastMode mode = RAYCAST_CLOSEST;
+  uint32_t tagMask = ~0u;
+  uint32_t maxHits = 0;
+  Blob* results = NULL;
+  bool shapes = false;
+
+  if (lua_istable(L, 3)) {
+    lua_getfield(L, 3, "mode");
+    mode = luaL_checkoption(L, -1, "closest", RaycastModes);
+    lua_pop(L, 1);
+
+    lua_getfield(L, 3, "tags");
+    tagMask = readTagMask(L, -1, world);
+    lua_pop(L, 1);
+
+    lua_getfield(L, 3, "maxhits");
+    maxHits = luaL_optinteger(L, -1, 0);
+    lua_pop(L, 1);
+
+    lua_getfield(L, 3, "results");
+    results = lua_isnil(L, -1) ? NULL : luax_checktype(L, -1, Blob);
+    lua_pop(L, 1);
+
+    lua_getfield(L, 3, "shapes");
+    shapes = lua_istable(L, -1);
+    if (!shapes) {
+      lua_pop(L, 1);
+    }
+  }
+
+  // Rays are read after every option is validated, since they may be copied into a temporary buffer
+  uint32_t rayCount;
+  bool allocated;
+  float* rays = readFloats(L, 2, 6, &rayCount, &allocated);
+
+  if (maxHits == 0) {
+    maxHits = mode == RAYCAST_ALL ? rayCount * MAX_CONTACTS : rayCount;
+  }
+
+  if (results) {
+    maxHits = MIN(maxHits, results->size / (RAYCAST_HIT_FLOATS * sizeof(float)));
+  }
+
+  RaycastHit* hits = malloc(MAX(maxHits, 1) * sizeof(RaycastHit));
+  if (!hits) {
+    if (allocated) free(rays);
+    lovrThrow("Out of memory");
+  }
+
+  uint32_t hitCount = lovrWorldRaycastBatch(world, rays, rayCount, mode, tagMask, hits, maxHits);
+
+  if (allocated) {
+    free(rays);
+  }
+
+  if (!results) {
+    size_t size = MAX(hitCount, 1) * RAYCAST_HIT_FLOATS * sizeof(float);
+    void* data = calloc(1, size);
+    if (!data) {
+      free(hits);
+      lovrThrow("Out of memory");
+    }
+    results = lovrBlobCreate(data, size, "Raycast results");
+    luax_pushobject(L, results);
+    lovrRelease(Blob, results);
+  } else {
+    lua_getfield(L, 3, "results");
+  }
+
+  // Layout: ray index (1-based), position, normal, distance
+  float* data = results->data;
+  for (uint32_t i = 0; i < hitCount; i++) {
+    RaycastHit* hit = &hits[i];
+    float* record = data + RAYCAST_HIT_FLOATS * i;
+    record[0] = hit->ray + 1;
+    memcpy(record + 1, hit->position, 3 * sizeof(float));
+    memcpy(record + 4, hit->normal, 3 * sizeof(float));
+    record[7] = hit->distance;
+
+    if (shapes) {
+      luax_pushobject(L, hit->shape);
+      lua_rawseti(L, -3, i + 1);
+    }
+  }
+
+  free(hits);
+  lua_pushinteger(L, hitCount);
+  lua_insert(L, -2);
+  return 2;
+}
+
+static int l_lovrWorldGetContactCapacity(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  lua_pushinteger(L, lovrWorldGetContactCapacity(world));
+  return 1;
+}
+
+static int l_lovrWorldSetContactCapacity(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  uint32_t capacity = luaL_checkinteger(L, 2);
+  lovrWorldSetContactCapacity(world, capacity);
+  return 0;
+}
+
+static int l_lovrWorldGetContacts(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  uint32_t capacity = lovrWorldGetContactCapacity(world);
+  Blob* results = NULL;
+  bool shapes = false;
+
+  if (lua_istable(L, 2)) {
+    lua_getfield(L, 2, "results");
+    results = lua_isnil(L, -1) ? NULL : luax_checktype(L, -1, Blob);
+    lua_pop(L, 1);
+
+    lua_getfield(L, 2, "shapes");
+    shapes = lua_istable(L, -1);
+    if (!shapes) {
+      lua_pop(L, 1);
+    }
+  }
+
+  if (results) {
+    capacity = MIN(capacity, results->size / (CONTACT_FLOATS * sizeof(float)));
+  }
+
+  ContactEvent* contacts = malloc(MAX(capacity, 1) * sizeof(ContactEvent));
+  lovrAssert(contacts, "Out of memory");
+  uint32_t count = lovrWorldGetContacts(world, contacts, capacity);
+
+  if (!results) {
+    size_t size = MAX(count, 1) * CONTACT_FLOATS * sizeof(float);
+    void* data = calloc(1, size);
+    lovrAssert(data, "Out of memory");
+    results = lovrBlobCreate(data, size, "Contacts");
+    luax_pushobject(L, results);
+    lovrRelease(Blob, results);
+  } else {
+    lua_getfield(L, 2, "results");
+  }
+
+  // Layout: position, normal, depth, impulse.  The shapes table gets the two shapes of each contact.
+  float* data = results->data;
+  for (uint32_t i = 0; i < count; i++) {
+    ContactEvent* contact = &contacts[i];
+    float* record = data + CONTACT_FLOATS * i;
+    memcpy(record + 0, contact->position, 3 * sizeof(float));
+    memcpy(record + 3, contact->normal, 3 * sizeof(float));
+    record[6] = contact->depth;
+    record[7] = contact->impulse;
+
+    if (shapes) {
+      luax_pushobject(L, contact->a);
+      lua_rawseti(L, -3, 2 * i + 1);
+      luax_pushobject(L, contact->b);
+      lua_rawseti(L, -3, 2 * i + 2);
+    }
+  }
+
+  free(contacts);
+  lua_pushinteger(L, count);
+  lua_insert(L, -2);
+  return 2;
+}
+
+static int l_lovrWorldDisableContactsBetween(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  const char* tag1 = luaL_checkstring(L, 2);
+  const char* tag2 = luaL_checkstring(L, 3);
+  lovrWorldDisableContactsBetween(world, tag1, tag2);
+  return 0;
+}
+
+static int l_lovrWorldEnableContactsBetween(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  const char* tag1 = luaL_checkstring(L, 2);
+  const char* tag2 = luaL_checkstring(L, 3);
+  lovrWorldEnableContactsBetween(world, tag1, tag2);
+  return 0;
+}
+
+static int l_lovrWorldSaveState(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  size_t size = lovrWorldGetStateSize(world);
+  Blob* blob = luax_totype(L, 2, Blob);
+
+  if (blob && blob->size >= size) {
+    lua_settop(L, 2);
+  } else {
+    void* data = malloc(size);
+    lovrAssert(data, "Out of memory");
+    blob = lovrBlobCreate(data, size, "World state");
+    luax_pushobject(L, blob);
+    lovrRelease(Blob, blob);
+  }
+
+  lovrWorldSaveState(world, blob->data);
+  return 1;
+}
+
+static int l_lovrWorldRestoreState(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  Blob* blob = luax_checktype(L, 2, Blob);
+  lovrWorldRestoreState(world, blob->data, blob->size);
+  return 0;
+}
+
+static int l_lovrWorldGetColliders(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  uint32_t count = lovrWorldGetColliderCount(world);
+
+  if (lua_istable(L, 2)) {
+    lua_settop(L, 2);
+  } else {
+    lua_settop(L, 1);
+    lua_createtable(L, count, 0);
+  }
+
+  int index = 1;
+  for (Collider* collider = world->head; collider; collider = collider->next) {
+    luax_pushobject(L, collider);
+    lua_rawseti(L, -2, index++);
+  }
+
+  return 1;
+}
+
+static int l_lovrWorldGetPoses(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  uint32_t count = checkColliders(L, 2, world);
+  PoseFormat format = luaL_checkoption(L, 4, "state", PoseFormats);
+  float rate;
+  uint32_t maxSubsteps;
+  lovrWorldGetStep(world, &rate, &maxSubsteps);
+  bool interpolate = lua_isnoneornil(L, 5) ? rate > 0.f : lua_toboolean(L, 5);
+  size_t stride = (format == POSE_MATRIX ? POSE_MATRIX_FLOATS : POSE_STATE_FLOATS) * sizeof(float);
+
+  // The destination is checked before the collider array is allocated
+  Blob* blob = NULL;
+#ifdef LOVR_ENABLE_GRAPHICS
+  ShaderBlock* block = NULL;
+#endif
+  if (!lua_isnoneornil(L, 3)) {
+    blob = luax_totype(L, 3, Blob);
+#ifdef LOVR_ENABLE_GRAPHICS
+    block = blob ? NULL : luax_checktype(L, 3, ShaderBlock);
+#else
+    blob = luax_checktype(L, 3, Blob);
+#endif
+  }
+
+  Collider** colliders;
+  lovrAssert(readColliders(L, 2, count, &colliders), "Out of memory");
+
+  if (lua_isnoneornil(L, 3)) {
+    void* data = calloc(1, MAX(count, 1) * stride);
+    if (!data) {
+      free(colliders);
+      lovrThrow("Out of memory");
+    }
+    blob = lovrBlobCreate(data, MAX(count, 1) * stride, "Collider poses");
+    count = lovrWorldGetPoses(world, colliders, count, format, interpolate, blob->data);
+    luax_pushobject(L, blob);
+    lovrRelease(Blob, blob);
+  } else {
+    if (blob) {
+      count = MIN(count, blob->size / stride);
+      count = lovrWorldGetPoses(world, colliders, count, format, interpolate, blob->data);
+    } else {
+#ifdef LOVR_ENABLE_GRAPHICS
+      Buffer* buffer = lovrShaderBlockGetBuffer(block);
+      count = MIN(count, lovrBufferGetSize(buffer) / stride);
+      count = lovrWorldGetPoses(world, colliders, count, format, interpolate, lovrBufferMap(buffer, 0));
+      lovrBufferFlush(buffer, 0, count * stride);
+#endif
+    }
+    lua_pushvalue(L, 3);
+  }
+
+  free(colliders);
+  lua_pushinteger(L, count);
+  lua_insert(L, -2);
+  return 2;
+}
+
+static int l_lovrWorldSetPoses(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  uint32_t count = checkColliders(L, 2, world);
+  PoseFormat format = luaL_checkoption(L, 4, "state", PoseFormats);
+  uint32_t poseCount;
+  bool allocated;
+  float* data = readFloats(L, 3, format == POSE_MATRIX ? POSE_MATRIX_FLOATS : POSE_STATE_FLOATS, &poseCount, &allocated);
+  Collider** colliders;
+  if (!readColliders(L, 2, count, &colliders)) {
+    if (allocated) {
+      free(data);
+    }
+    lovrThrow("Out of memory");
+  }
+
+  count = lovrWorldSetPoses(world, colliders, MIN(count, poseCount), format, data);
+
+  if (allocated) {
+    free(data);
+  }
+
+  free(colliders);
+  lua_pushinteger(L, count);
+  return 1;
+}
+
 static int l_lovrWorldDisableCollisionBetween(lua_State* L) {
   World* world = luax_checktype(L, 1, World);
   const char* tag1 = luaL_checkstring(L, 2);
@@ -259,11 +861,30 @@ const luaL_Reg lovrWorld[] = {
   { "newBoxCollider", l_lovrWorldNewBoxCollider },
   { "newCapsuleCollider", l_lovrWorldNewCapsuleCollider },
   { "newCylinderCollider", l_lovrWorldNewCylinderCollider },
+  { "newMeshCollider", l_lovrWorldNewMeshCollider },
+  { "newTerrainCollider", l_lovrWorldNewTerrainCollider },
   { "newSphereCollider", l_lovrWorldNewSphereCollider },
   { "destroy", l_lovrWorldDestroy },
   { "update", l_lovrWorldUpdate },
+  { "getStep", l_lovrWorldGetStep },
+  { "setStep", l_lovrWorldSetStep },
+  { "getInterpolation", l_lovrWorldGetInterpolation },
+  { "getStats", l_lovrWorldGetStats },
+  { "getThreadCount", l_lovrWorldGetThreadCount },
+  { "setThreadCount", l_lovrWorldSetThreadCount },
   { "computeOverlaps", l_lovrWorldComputeOverlaps },
   { "overlaps", l_lovrWorldOverlaps },
+  { "getOverlaps", l_lovrWorldGetOverlaps },
+  { "getContactCapacity", l_lovrWorldGetContactCapacity },
+  { "setContactCapacity", l_lovrWorldSetContactCapacity },
+  { "getContacts", l_lovrWorldGetContacts },
+  { "saveState", l_lovrWorldSaveState },
+  { "restoreState", l_lovrWorldRestoreState },
+  { "disableContactsBetween", l_lovrWorldDisableContactsBetween },
+  { "enableContactsBetween", l_lovrWorldEnableContactsBetween },
+  { "queryAABB", l_lovrWorldQueryAABB },
+  { "queryBox", l_lovrWorldQueryBox },
+  { "querySphere", l_lovrWorldQuerySphere },
   { "collide", l_lovrWorldCollide },
   { "getGravity", l_lovrWorldGetGravity },
   { "setGravity", l_lovrWorldSetGravity },
@@ -274,6 +895,10 @@ const luaL_Reg lovrWorld[] = {
   { "isSleepingAllowed", l_lovrWorldIsSleepingAllowed },
   { "setSleepingAllowed", l_lovrWorldSetSleepingAllowed },
   { "raycast", l_lovrWorldRaycast },
+  { "raycastBatch", l_lovrWorldRaycastBatch },
+  { "getColliders", l_lovrWorldGetColliders },
+  { "getPoses", l_lovrWorldGetPoses },
+  { "setPoses", l_lovrWorldSetPoses },
   { "disableCollisionBetween", l_lovrWorldDisableCollisionBetween },
   { "enableCollisionBetween", l_lovrWorldEnableCollisionBetween },
   { "isCollisionEnabledBetween", l_lovrWorldIsCollisionEnabledBetween },
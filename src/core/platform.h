@@ -22,6 +22,7 @@ typedef struct {
   uint32_t width;
   uint32_t height;
   bool fullscreen;
+  bool headless;
   int vsync;
   int msaa;
   const char* title;
@@ -0,0 +1,192 @@
+#include "util.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <time.h>
+
+// Include this in ONE translation unit
+
+// Headless platform: there is no window or input, rendering goes to an offscreen pbuffer surface that
+// stands in for the default framebuffer, so the graphics module runs unmodified on machines without a
+// display server (e.g. Mesa's surfaceless platform with llvmpipe, or a GPU driver's device platform).
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+getProcAddressProc lovrGetProcAddress = (getProcAddressProc) eglGetProcAddress;
+
+static struct {
+  EGLDisplay display;
+  EGLContext context;
+  EGLSurface surface;
+  int width;
+  int height;
+  double epoch;
+} state;
+
+static double getClockTime() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double) t.tv_sec + (t.tv_nsec / 1e9);
+}
+
+bool lovrPlatformInit() {
+  const char* extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  if (extensions && strstr(extensions, "EGL_MESA_platform_surfaceless")) {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (eglGetPlatformDisplayEXT) {
+      state.display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+  }
+
+  if (state.display == EGL_NO_DISPLAY) {
+    state.display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+
+  if (state.display == EGL_NO_DISPLAY || !eglInitialize(state.display, NULL, NULL)) {
+    return false;
+  }
+
+  state.epoch = getClockTime();
+  return true;
+}
+
+void lovrPlatformDestroy() {
+  if (state.display != EGL_NO_DISPLAY) {
+    eglMakeCurrent(state.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (state.surface != EGL_NO_SURFACE) eglDestroySurface(state.display, state.surface);
+    if (state.context != EGL_NO_CONTEXT) eglDestroyContext(state.display, state.context);
+    eglTerminate(state.display);
+  }
+  memset(&state, 0, sizeof(state));
+}
+
+void lovrPlatformPollEvents() {
+  //
+}
+
+double lovrPlatformGetTime() {
+  return getClockTime() - state.epoch;
+}
+
+void lovrPlatformSetTime(double t) {
+  state.epoch = getClockTime() - t;
+}
+
+bool lovrPlatformCreateWindow(WindowFlags* flags) {
+  if (state.context) {
+    return true;
+  }
+
+  EGLint configAttributes[] = {
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_RED_SIZE, 8,
+    EGL_GREEN_SIZE, 8,
+    EGL_BLUE_SIZE, 8,
+    EGL_ALPHA_SIZE, 8,
+    EGL_DEPTH_SIZE, 24,
+    EGL_STENCIL_SIZE, 8,
+    EGL_SAMPLE_BUFFERS, flags->msaa > 0,
+    EGL_SAMPLES, flags->msaa,
+    EGL_NONE
+  };
+
+  EGLConfig config;
+  EGLint configCount;
+  if (!eglChooseConfig(state.display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+    return false;
+  }
+
+  if (!eglBindAPI(EGL_OPENGL_API)) {
+    return false;
+  }
+
+  EGLint contextAttributes[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 3,
+    EGL_CONTEXT_MINOR_VERSION, 3,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE
+  };
+
+  state.context = eglCreateContext(state.display, config, EGL_NO_CONTEXT, contextAttributes);
+  if (state.context == EGL_NO_CONTEXT) {
+    return false;
+  }
+
+  state.width = flags->width ? flags->width : 1080;
+  state.height = flags->height ? flags->height : 600;
+
+  EGLint surfaceAttributes[] = {
+    EGL_WIDTH, state.width,
+    EGL_HEIGHT, state.height,
+    EGL_NONE
+  };
+
+  state.surface = eglCreatePbufferSurface(state.display, config, surfaceAttributes);
+  if (state.surface == EGL_NO_SURFACE) {
+    eglDestroyContext(state.display, state.context);
+    state.context = EGL_NO_CONTEXT;
+    return false;
+  }
+
+  if (!eglMakeCurrent(state.display, state.surface, state.surface, state.context)) {
+    return false;
+  }
+
+  // Benchmarks want to measure submission cost, never block on a fake display
+  lovrPlatformSetSwapInterval(0);
+  return true;
+}
+
+bool lovrPlatformHasWindow() {
+  return state.context != EGL_NO_CONTEXT;
+}
+
+void lovrPlatformGetWindowSize(int* width, int* height) {
+  if (width) *width = state.width;
+  if (height) *height = state.height;
+}
+
+void lovrPlatformGetFramebufferSize(int* width, int* height) {
+  if (width) *width = state.width;
+  if (height) *height = state.height;
+}
+
+void lovrPlatformSetSwapInterval(int interval) {
+  if (state.context) {
+    eglSwapInterval(state.display, interval);
+  }
+}
+
+void lovrPlatformSwapBuffers() {
+  eglSwapBuffers(state.display, state.surface);
+}
+
+void lovrPlatformOnWindowClose(windowCloseCallback callback) {
+  //
+}
+
+void lovrPlatformOnWindowResize(windowResizeCallback callback) {
+  //
+}
+
+void lovrPlatformOnMouseButton(mouseButtonCallback callback) {
+  //
+}
+
+void lovrPlatformGetMousePosition(double* x, double* y) {
+  *x = *y = 0.;
+}
+
+void lovrPlatformSetMouseMode(MouseMode mode) {
+  //
+}
+
+bool lovrPlatformIsMouseDown(MouseButton button) {
+  return false;
+}
+
+bool lovrPlatformIsKeyDown(KeyCode key) {
+  return false;
+}
@@ -98,6 +98,7 @@ bool lovrPlatformCreateWindow(WindowFlags* flags) {
   glfwWindowHint(GLFW_SAMPLES, flags->msaa);
   glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
   glfwWindowHint(GLFW_SRGB_CAPABLE, GLFW_TRUE);
+  glfwWindowHint(GLFW_VISIBLE, flags->headless ? GLFW_FALSE : GLFW_TRUE);
 
   GLFWmonitor* monitor = glfwGetPrimaryMonitor();
   const GLFWvidmode* mode = glfwGetVideoMode(monitor);
@@ -111,7 +112,8 @@ bool lovrPlatformCreateWindow(WindowFlags* flags) {
     glfwWindowHint(GLFW_REFRESH_RATE, mode->refreshRate);
   }
 
-  state.window = glfwCreateWindow(width, height, flags->title, flags->fullscreen ? monitor : NULL, NULL);
+  bool fullscreen = flags->fullscreen && !flags->headless;
+  state.window = glfwCreateWindow(width, height, flags->title, fullscreen ? monitor : NULL, NULL);
 
   if (!state.window) {
     return false;
@@ -129,7 +131,7 @@ bool lovrPlatformCreateWindow(WindowFlags* flags) {
   glfwSetWindowCloseCallback(state.window, onWindowClose);
   glfwSetWindowSizeCallback(state.window, onWindowResize);
   glfwSetMouseButtonCallback(state.window, onMouseButton);
-  lovrPlatformSetSwapInterval(flags->vsync);
+  lovrPlatformSetSwapInterval(flags->headless ? 0 : flags->vsync);
   return true;
 }
 
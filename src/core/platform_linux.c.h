@@ -2,7 +2,11 @@
 #include <unistd.h>
 #include <string.h>
 
+#ifdef LOVR_HEADLESS
+#include "platform_egl.c.h"
+#else
 #include "platform_glfw.c.h"
+#endif
 
 const char* lovrPlatformGetName() {
   return "Linux";
@@ -0,0 +1,275 @@
+#include "profiler.h"
+#include "platform.h"
+#include "util.h"
+#include "lib/sds/sds.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <intrin.h>
+#define atomic_claim(c) (_InterlockedIncrement(&c) - 1)
+#define atomic_swap(c, v) _InterlockedExchange(&c, v)
+#define atomic_lock(l) while (_InterlockedExchange(&l, 1)) {}
+#define atomic_unlock(l) _InterlockedExchange(&l, 0)
+typedef long AtomicCounter;
+#else
+#include <stdatomic.h>
+#define atomic_claim(c) atomic_fetch_add(&c, 1)
+#define atomic_swap(c, v) atomic_exchange(&c, v)
+#define atomic_lock(l) while (atomic_exchange_explicit(&l, 1, memory_order_acquire)) {}
+#define atomic_unlock(l) atomic_store_explicit(&l, 0, memory_order_release)
+typedef _Atomic long AtomicCounter;
+#endif
+
+// Each thread writes finished zones into its own ring.  When a ring fills up, the oldest zones are
+// overwritten.  The ring's spinlock is only contended while another thread clears or exports it, and
+// exporting copies the ring out first so the owner is never held up by formatting.  Buffers are never
+// freed, since an export could be reading them, but a thread buffer is handed to a new thread once the
+// thread that owned it exits.
+
+typedef struct {
+  double start;
+  double duration;
+  uint16_t depth;
+  char name[MAX_ZONE_NAME_LENGTH];
+} Zone;
+
+typedef struct {
+  uint32_t id;
+  const char* label;
+  uint32_t depth;
+  AtomicCounter lock;
+  AtomicCounter used;
+  uint64_t head;
+  uint64_t tail;
+  double stack[MAX_PROFILER_DEPTH];
+  char names[MAX_PROFILER_DEPTH][MAX_ZONE_NAME_LENGTH];
+  Zone zones[MAX_PROFILER_EVENTS];
+} ZoneBuffer;
+
+static struct {
+  AtomicCounter threadCount;
+  ZoneBuffer* threads[MAX_PROFILER_THREADS];
+} state;
+
+static LOVR_THREAD_LOCAL ZoneBuffer* localBuffer;
+static LOVR_THREAD_LOCAL bool localBufferFull;
+
+static ZoneBuffer* createBuffer(const char* label) {
+  if (!label) {
+    for (uint32_t i = 0; i < MAX_PROFILER_THREADS; i++) {
+      ZoneBuffer* buffer = state.threads[i];
+      if (buffer && !buffer->label && atomic_swap(buffer->used, 1) == 0) {
+        atomic_lock(buffer->lock);
+        buffer->depth = 0;
+        buffer->tail = buffer->head;
+        atomic_unlock(buffer->lock);
+        return buffer;
+      }
+    }
+  }
+
+  long index = atomic_claim(state.threadCount);
+  if (index >= MAX_PROFILER_THREADS) {
+    return NULL;
+  }
+
+  ZoneBuffer* buffer = calloc(1, sizeof(ZoneBuffer));
+  lovrAssert(buffer, "Out of memory");
+  buffer->id = (uint32_t) index;
+  buffer->label = label;
+  buffer->used = 1;
+  state.threads[index] = buffer;
+  return buffer;
+}
+
+static ZoneBuffer* getBuffer() {
+  if (localBuffer || localBufferFull) {
+    return localBuffer;
+  }
+
+  localBuffer = createBuffer(NULL);
+  localBufferFull = !localBuffer;
+  return localBuffer;
+}
+
+static void pushZone(ZoneBuffer* buffer, const char* name, double start, double duration, uint16_t depth) {
+  atomic_lock(buffer->lock);
+  Zone* zone = &buffer->zones[buffer->head % MAX_PROFILER_EVENTS];
+  zone->start = start;
+  zone->duration = duration;
+  zone->depth = depth;
+  memcpy(zone->name, name, MAX_ZONE_NAME_LENGTH);
+  buffer->head++;
+  atomic_unlock(buffer->lock);
+}
+
+// Copies the recorded zones of a ring into zones (oldest first) and returns how many there were
+static uint32_t readZones(ZoneBuffer* buffer, Zone* zones) {
+  atomic_lock(buffer->lock);
+  uint64_t count = MIN(buffer->head - buffer->tail, MAX_PROFILER_EVENTS);
+  for (uint64_t i = 0, j = buffer->head - count; j < buffer->head; i++, j++) {
+    zones[i] = buffer->zones[j % MAX_PROFILER_EVENTS];
+  }
+  atomic_unlock(buffer->lock);
+  return (uint32_t) count;
+}
+
+void lovrProfilerBegin(const char* name) {
+  ZoneBuffer* buffer = getBuffer();
+  if (!buffer) return;
+  if (buffer->depth < MAX_PROFILER_DEPTH) {
+    strncpy(buffer->names[buffer->depth], name, MAX_ZONE_NAME_LENGTH - 1);
+    buffer->stack[buffer->depth] = lovrPlatformGetTime();
+  }
+  buffer->depth++;
+}
+
+void lovrProfilerEnd() {
+  ZoneBuffer* buffer = localBuffer;
+  if (!buffer || buffer->depth == 0) return;
+  uint32_t depth = --buffer->depth;
+  if (depth >= MAX_PROFILER_DEPTH) return;
+  double start = buffer->stack[depth];
+  pushZone(buffer, buffer->names[depth], start, lovrPlatformGetTime() - start, (uint16_t) depth);
+}
+
+uint32_t lovrProfilerGetDepth() {
+  return localBuffer ? localBuffer->depth : 0;
+}
+
+// Discards zones on the current thread that were opened past the given depth and never ended
+void lovrProfilerUnwind(uint32_t depth) {
+  if (localBuffer && localBuffer->depth > depth) {
+    localBuffer->depth = depth;
+  }
+}
+
+// The zones the thread recorded stay in the buffer until another thread claims it
+void lovrProfilerReleaseThread() {
+  if (localBuffer) {
+    localBuffer->depth = 0;
+    atomic_swap(localBuffer->used, 0);
+  }
+
+  localBuffer = NULL;
+  localBufferFull = false;
+}
+
+// Records a zone with explicit timing on a named track (e.g. GPU work resolved after the fact).
+// Tracks are keyed by the label pointer, created on first use, and written by a single thread.
+void lovrProfilerRecord(const char* track, const char* name, double start, double duration) {
+  ZoneBuffer* buffer = NULL;
+  for (uint32_t i = 0; i < MAX_PROFILER_THREADS; i++) {
+    if (state.threads[i] && state.threads[i]->label == track) {
+      buffer = state.threads[i];
+      break;
+    }
+  }
+
+  if (!buffer && (buffer = createBuffer(track)) == NULL) {
+    return;
+  }
+
+  char zoneName[MAX_ZONE_NAME_LENGTH] = { 0 };
+  strncpy(zoneName, name, MAX_ZONE_NAME_LENGTH - 1);
+  pushZone(buffer, zoneName, start, duration, 0);
+}
+
+void lovrProfilerClear() {
+  for (uint32_t i = 0; i < MAX_PROFILER_THREADS; i++) {
+    ZoneBuffer* buffer = state.threads[i];
+    if (buffer) {
+      atomic_lock(buffer->lock);
+      buffer->tail = buffer->head;
+      atomic_unlock(buffer->lock);
+    }
+  }
+}
+
+static sds catJsonString(sds s, const char* str) {
+  s = sdscatlen(s, "\"", 1);
+  for (const char* c = str; *c; c++) {
+    if (*c == '"' || *c == '\\') {
+      s = sdscatlen(s, "\\", 1);
+    } else if ((unsigned char) *c < 0x20) {
+      continue;
+    }
+    s = sdscatlen(s, c, 1);
+  }
+  return sdscatlen(s, "\"", 1);
+}
+
+static sds exportChrome(Zone* zones) {
+  sds trace = sdsnew("{\"traceEvents\":[");
+  bool first = true;
+
+  for (uint32_t i = 0; i < MAX_PROFILER_THREADS; i++) {
+    ZoneBuffer* buffer = state.threads[i];
+    if (!buffer) continue;
+
+    if (buffer->label) {
+      trace = sdscatprintf(trace, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":",
+        first ? "" : ",", buffer->id);
+      trace = sdscat(catJsonString(trace, buffer->label), "}}");
+      first = false;
+    }
+
+    uint32_t count = readZones(buffer, zones);
+    for (uint32_t j = 0; j < count; j++) {
+      Zone* zone = &zones[j];
+      trace = sdscat(trace, first ? "{\"name\":" : ",{\"name\":");
+      trace = catJsonString(trace, zone->name);
+      trace = sdscatprintf(trace, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u}",
+        zone->start * 1e6, zone->duration * 1e6, buffer->id);
+      first = false;
+    }
+  }
+
+  return sdscat(trace, "]}");
+}
+
+// Binary layout (little endian): "LVRP", u32 version, u32 zone count, then per zone: u32 thread,
+// u16 depth, u8 name length, name bytes, f64 start, f64 duration (seconds)
+static sds exportBinary(Zone* zones) {
+  sds data = sdsnewlen("LVRP", 4);
+  uint32_t version = 1;
+  uint32_t total = 0;
+  data = sdscatlen(data, &version, sizeof(version));
+  data = sdscatlen(data, &total, sizeof(total));
+
+  for (uint32_t i = 0; i < MAX_PROFILER_THREADS; i++) {
+    ZoneBuffer* buffer = state.threads[i];
+    if (!buffer) continue;
+
+    uint32_t count = readZones(buffer, zones);
+    for (uint32_t j = 0; j < count; j++) {
+      Zone* zone = &zones[j];
+      uint8_t length = (uint8_t) strlen(zone->name);
+      data = sdscatlen(data, &buffer->id, sizeof(uint32_t));
+      data = sdscatlen(data, &zone->depth, sizeof(uint16_t));
+      data = sdscatlen(data, &length, sizeof(uint8_t));
+      data = sdscatlen(data, zone->name, length);
+      data = sdscatlen(data, &zone->start, sizeof(double));
+      data = sdscatlen(data, &zone->duration, sizeof(double));
+      total++;
+    }
+  }
+
+  memcpy(data + 8, &total, sizeof(total));
+  return data;
+}
+
+// Returns a buffer that the caller is responsible for freeing
+void* lovrProfilerExport(ProfileFormat format, size_t* size) {
+  Zone* zones = malloc(MAX_PROFILER_EVENTS * sizeof(Zone));
+  lovrAssert(zones, "Out of memory");
+  sds result = format == PROFILE_CHROME ? exportChrome(zones) : exportBinary(zones);
+  free(zones);
+  *size = sdslen(result);
+  void* data = malloc(*size);
+  lovrAssert(data, "Out of memory");
+  memcpy(data, result, *size);
+  sdsfree(result);
+  return data;
+}
@@ -0,0 +1,43 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#pragma once
+
+#define MAX_PROFILER_THREADS 32
+#define MAX_PROFILER_DEPTH 64
+#define MAX_PROFILER_EVENTS 16384
+#define MAX_ZONE_NAME_LENGTH 32
+
+typedef enum {
+  PROFILE_CHROME,
+  PROFILE_BINARY
+} ProfileFormat;
+
+// Zones are compiled out entirely unless LOVR_ENABLE_PROFILER is set.  Every LOVR_ZONE_BEGIN needs
+// a matching LOVR_ZONE_END on the same thread, including on early returns.  Errors skip the END, so
+// code that catches errors saves LOVR_ZONE_DEPTH beforehand and restores it with LOVR_ZONE_UNWIND.
+// Threads call LOVR_ZONE_RELEASE_THREAD before exiting so their zone buffer can be reused.
+#ifdef LOVR_ENABLE_PROFILER
+#define LOVR_ZONE_BEGIN(name) lovrProfilerBegin(name)
+#define LOVR_ZONE_END() lovrProfilerEnd()
+#define LOVR_ZONE_DEPTH() lovrProfilerGetDepth()
+#define LOVR_ZONE_UNWIND(depth) lovrProfilerUnwind(depth)
+#define LOVR_ZONE_RELEASE_THREAD() lovrProfilerReleaseThread()
+#define LOVR_ZONE_RECORD(track, name, start, duration) lovrProfilerRecord(track, name, start, duration)
+#else
+#define LOVR_ZONE_BEGIN(name) ((void) (name))
+#define LOVR_ZONE_END() ((void) 0)
+#define LOVR_ZONE_DEPTH() 0
+#define LOVR_ZONE_UNWIND(depth) ((void) (depth))
+#define LOVR_ZONE_RELEASE_THREAD() ((void) 0)
+#define LOVR_ZONE_RECORD(track, name, start, duration) ((void) 0)
+#endif
+
+void lovrProfilerBegin(const char* name);
+void lovrProfilerEnd(void);
+uint32_t lovrProfilerGetDepth(void);
+void lovrProfilerUnwind(uint32_t depth);
+void lovrProfilerReleaseThread(void);
+void lovrProfilerRecord(const char* track, const char* name, double start, double duration);
+void lovrProfilerClear(void);
+void* lovrProfilerExport(ProfileFormat format, size_t* size);
@@ -58,6 +58,7 @@ const TypeInfo lovrTypeInfo[T_MAX] = {
   INFO(Joint),
   INFO(Material),
   INFO(Mesh),
+  SUPERINFO(MeshShape, Shape),
   INFO(Microphone),
   INFO(Model),
   INFO(ModelData),
@@ -71,6 +72,7 @@ const TypeInfo lovrTypeInfo[T_MAX] = {
   INFO(SoundData),
   INFO(Source),
   SUPERINFO(SphereShape, Shape),
+  SUPERINFO(TerrainShape, Shape),
   INFO(Texture),
   INFO(TextureData),
 #ifdef LOVR_ENABLE_THREAD
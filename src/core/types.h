@@ -26,6 +26,7 @@ typedef enum {
   T_Joint,
   T_Material,
   T_Mesh,
+  T_MeshShape,
   T_Microphone,
   T_Model,
   T_ModelData,
@@ -39,6 +40,7 @@ typedef enum {
   T_SoundData,
   T_Source,
   T_SphereShape,
+  T_TerrainShape,
   T_Texture,
   T_TextureData,
   T_Thread,
@@ -3,6 +3,9 @@
 #include "luax.h"
 #include "platform.h"
 #include "util.h"
+#ifdef LOVR_ENABLE_TIMER
+#include "timer/timer.h"
+#endif
 #include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
@@ -81,7 +84,11 @@ int main(int argc, char** argv) {
     return 0;
 #else
     while (lua_resume(T, 0) == LUA_YIELD) {
+#ifdef LOVR_ENABLE_TIMER
+      lovrTimerPace();
+#else
       lovrPlatformSleep(.001);
+#endif
     }
 
     restart = lua_type(T, -1) == LUA_TSTRING && !strcmp(lua_tostring(T, -1), "restart");
@@ -2,6 +2,7 @@
 #include "audio/source.h"
 #include "data/audioStream.h"
 #include "core/maf.h"
+#include "core/profiler.h"
 #include "lib/vec/vec.h"
 #include "types.h"
 #include "util.h"
@@ -75,6 +76,7 @@ void lovrAudioDestroy() {
 }
 
 void lovrAudioUpdate() {
+  LOVR_ZONE_BEGIN("lovrAudioUpdate");
   int i; Source* source;
   vec_foreach_rev(&state.sources, source, i) {
     if (lovrSourceGetType(source) == SOURCE_STATIC) {
@@ -99,6 +101,7 @@ void lovrAudioUpdate() {
       lovrRelease(Source, source);
     }
   }
+  LOVR_ZONE_END();
 }
 
 void lovrAudioAdd(Source* source) {
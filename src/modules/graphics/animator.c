@@ -1,6 +1,7 @@
 #include "graphics/animator.h"
 #include "data/modelData.h"
 #include "core/maf.h"
+#include "core/profiler.h"
 #include "types.h"
 #include <stdlib.h>
 #include <math.h>
@@ -53,6 +54,7 @@ void lovrAnimatorReset(Animator* animator) {
 }
 
 void lovrAnimatorUpdate(Animator* animator, float dt) {
+  LOVR_ZONE_BEGIN("lovrAnimatorUpdate");
   Track* track; int i;
   vec_foreach_ptr(&animator->tracks, track, i) {
     if (track->playing) {
@@ -67,6 +69,7 @@ void lovrAnimatorUpdate(Animator* animator, float dt) {
       }
     }
   }
+  LOVR_ZONE_END();
 }
 
 bool lovrAnimatorEvaluate(Animator* animator, uint32_t nodeIndex, mat4 transform) {
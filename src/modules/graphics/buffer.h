@@ -10,6 +10,7 @@ typedef enum {
   BUFFER_UNIFORM,
   BUFFER_SHADER_STORAGE,
   BUFFER_GENERIC,
+  BUFFER_DRAW_INDIRECT,
   MAX_BUFFER_TYPES
 } BufferType;
 
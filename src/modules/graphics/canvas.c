@@ -29,7 +29,8 @@ void lovrCanvasSetAttachments(Canvas* canvas, Attachment* attachments, uint32_t
     lovrAssert(level < mipmaps, "Invalid attachment mipmap level (Texture has %d, got %d)", mipmaps, level + 1);
     lovrAssert(!hasDepthBuffer || width == canvas->width, "Texture width of %d does not match Canvas width (%d)", width, canvas->width);
     lovrAssert(!hasDepthBuffer || height == canvas->height, "Texture height of %d does not match Canvas height (%d)", height, canvas->height);
-    lovrAssert(texture->msaa == canvas->flags.msaa, "Texture MSAA does not match Canvas MSAA");
+    lovrAssert(canvas->flags.multiview || texture->msaa == canvas->flags.msaa, "Texture MSAA does not match Canvas MSAA");
+    lovrAssert(!canvas->flags.multiview || (texture->type == TEXTURE_ARRAY && slice + 2 <= depth), "Multiview Canvases need array Textures with 2 layers to render to");
     lovrRetain(texture);
   }
 
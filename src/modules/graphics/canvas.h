@@ -21,6 +21,7 @@ typedef struct {
     TextureFormat format;
   } depth;
   bool stereo;
+  bool multiview;
   uint32_t msaa;
   bool mipmaps;
 } CanvasFlags;
@@ -1,6 +1,7 @@
 #include "graphics/font.h"
 #include "graphics/texture.h"
 #include "data/textureData.h"
+#include "core/profiler.h"
 #include "core/utf.h"
 #include <string.h>
 #include <stdlib.h>
@@ -66,6 +67,7 @@ Rasterizer* lovrFontGetRasterizer(Font* font) {
 }
 
 void lovrFontRender(Font* font, const char* str, size_t length, float wrap, HorizontalAlign halign, float* vertices, uint16_t* indices, uint16_t baseVertex) {
+  LOVR_ZONE_BEGIN("lovrFontRender");
   FontAtlas* atlas = &font->atlas;
   bool flip = font->flip;
 
@@ -116,6 +118,7 @@ void lovrFontRender(Font* font, const char* str, size_t length, float wrap, Hori
     // Start over if texture was repacked
     if (u != atlas->width || v != atlas->height) {
       lovrFontRender(font, start, length, wrap, halign, vertices, indices, baseVertex);
+      LOVR_ZONE_END();
       return;
     }
 
@@ -151,6 +154,7 @@ void lovrFontRender(Font* font, const char* str, size_t length, float wrap, Hori
 
   // Align the last line
   lovrFontAlignLine(lineStart, vertexCursor, cx, halign);
+  LOVR_ZONE_END();
 }
 
 void lovrFontMeasure(Font* font, const char* str, size_t length, float wrap, float* width, uint32_t* lineCount, uint32_t* glyphCount) {
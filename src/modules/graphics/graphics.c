@@ -8,9 +8,14 @@
 #include "event/event.h"
 #include "math/math.h"
 #include "core/maf.h"
+#include "core/profiler.h"
+#ifdef LOVR_ENABLE_TIMER
+#include "timer/timer.h"
+#endif
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <float.h>
 
 static GraphicsState state;
 
@@ -35,10 +40,16 @@ static const uint32_t BUFFER_COUNTS[] = {
   [STREAM_DRAW_ID] = (1 << 16) - 1,
 #if defined(LOVR_WEBGL) || defined(__APPLE__) // Work around bugs where big UBOs don't work
   [STREAM_TRANSFORM] = MAX_DRAWS,
-  [STREAM_COLOR] = MAX_DRAWS
+  [STREAM_COLOR] = MAX_DRAWS,
+  [STREAM_MATERIAL] = MAX_DRAWS,
+  [STREAM_INSTANCE] = MAX_INSTANCES,
+  [STREAM_INDIRECT] = MAX_DRAWS
 #else
   [STREAM_TRANSFORM] = MAX_DRAWS * MAX_BATCHES * 2,
-  [STREAM_COLOR] = MAX_DRAWS * MAX_BATCHES * 2
+  [STREAM_COLOR] = MAX_DRAWS * MAX_BATCHES * 2,
+  [STREAM_MATERIAL] = MAX_DRAWS * MAX_BATCHES * 2,
+  [STREAM_INSTANCE] = MAX_INSTANCES,
+  [STREAM_INDIRECT] = MAX_DRAWS * MAX_BATCHES * 2
 #endif
 };
 
@@ -47,7 +58,10 @@ static const size_t BUFFER_STRIDES[] = {
   [STREAM_INDEX] = sizeof(uint16_t),
   [STREAM_DRAW_ID] = sizeof(uint8_t),
   [STREAM_TRANSFORM] = 16 * sizeof(float),
-  [STREAM_COLOR] = 4 * sizeof(float)
+  [STREAM_COLOR] = 4 * sizeof(float),
+  [STREAM_MATERIAL] = MATERIAL_BLOCK_FLOATS * sizeof(float),
+  [STREAM_INSTANCE] = INSTANCE_STRIDE,
+  [STREAM_INDIRECT] = 5 * sizeof(uint32_t)
 };
 
 static const BufferType BUFFER_TYPES[] = {
@@ -55,7 +69,10 @@ static const BufferType BUFFER_TYPES[] = {
   [STREAM_INDEX] = BUFFER_INDEX,
   [STREAM_DRAW_ID] = BUFFER_GENERIC,
   [STREAM_TRANSFORM] = BUFFER_UNIFORM,
-  [STREAM_COLOR] = BUFFER_UNIFORM
+  [STREAM_COLOR] = BUFFER_UNIFORM,
+  [STREAM_MATERIAL] = BUFFER_UNIFORM,
+  [STREAM_INSTANCE] = BUFFER_VERTEX,
+  [STREAM_INDIRECT] = BUFFER_GENERIC
 };
 
 static void lovrGraphicsInitBuffers() {
@@ -121,7 +138,16 @@ static void* lovrGraphicsMapBuffer(BufferRole role, uint32_t count) {
   return lovrBufferMap(buffer, state.cursors[role] * BUFFER_STRIDES[role]);
 }
 
-static bool areBatchParamsEqual(BatchType typeA, BatchType typeB, BatchParams* a, BatchParams* b) {
+// Material parameters are stored per draw, so draws can share a batch as long as their textures match
+static bool areMaterialTexturesEqual(Material* a, Material* b) {
+  return a == b || !memcmp(a->textures, b->textures, sizeof(a->textures));
+}
+
+// Mesh batches that are submitted with multi-draw can mix draw ranges, since each draw gets its own
+// indirect command.  They can also mix meshes that share their vertex and index buffers, like the
+// primitives of a Model, as long as the batch's mesh can address the other mesh's vertices.  The
+// first params belong to the draw and the second to the batch.
+static bool areBatchParamsEqual(BatchType typeA, BatchType typeB, BatchParams* a, BatchParams* b, bool multiDraw) {
   if (typeA != typeB) return false;
 
   switch (typeA) {
@@ -139,10 +165,17 @@ static bool areBatchParamsEqual(BatchType typeA, BatchType typeB, BatchParams* a
         a->cylinder.capped == b->cylinder.capped && a->cylinder.segments == b->cylinder.segments;
     case BATCH_SPHERE:
       return a->sphere.segments == b->sphere.segments;
-    case BATCH_MESH:
-      return
-        a->mesh.object == b->mesh.object && a->mesh.mode == b->mesh.mode &&
-        a->mesh.rangeStart == b->mesh.rangeStart && a->mesh.rangeCount == b->mesh.rangeCount;
+    case BATCH_MESH: {
+      if (a->mesh.mode != b->mesh.mode) {
+        return false;
+      } else if (!multiDraw) {
+        return a->mesh.object == b->mesh.object && a->mesh.rangeStart == b->mesh.rangeStart && a->mesh.rangeCount == b->mesh.rangeCount;
+      }
+
+      int32_t baseVertex;
+      bool indexed = b->mesh.object->indexCount > 0;
+      return lovrMeshGetBaseVertex(b->mesh.object, a->mesh.object, &baseVertex) && (indexed || (int64_t) a->mesh.rangeStart + baseVertex >= 0);
+    }
     default:
       return true;
   }
@@ -160,7 +193,8 @@ void lovrGraphicsDestroy() {
   lovrGraphicsSetFont(NULL);
   lovrGraphicsSetCanvas(NULL);
   for (int i = 0; i < MAX_DEFAULT_SHADERS; i++) {
-    lovrRelease(Shader, state.defaultShaders[i]);
+    lovrRelease(Shader, state.defaultShaders[i][0]);
+    lovrRelease(Shader, state.defaultShaders[i][1]);
   }
   for (int i = 0; i < MAX_BUFFER_ROLES; i++) {
     lovrRelease(Buffer, state.buffers[i]);
@@ -171,16 +205,29 @@ void lovrGraphicsDestroy() {
   lovrRelease(Mesh, state.mesh);
   lovrRelease(Mesh, state.instancedMesh);
   lovrRelease(Buffer, state.identityBuffer);
-  lovrRelease(Material, state.defaultMaterial);
+  for (int i = 0; i < MAX_DEFAULT_MATERIALS; i++) {
+    lovrRelease(Material, state.defaultMaterials[i]);
+  }
   lovrRelease(Font, state.defaultFont);
   lovrGpuDestroy();
   memset(&state, 0, sizeof(GraphicsState));
 }
 
 void lovrGraphicsPresent() {
+  LOVR_ZONE_BEGIN("lovrGraphicsPresent");
   lovrGraphicsFlush();
+#ifdef LOVR_ENABLE_TIMER
+  double start = lovrPlatformGetTime();
   lovrPlatformSwapBuffers();
+  lovrTimerAddBlockedTime(lovrPlatformGetTime() - start);
+#else
+  lovrPlatformSwapBuffers();
+#endif
   lovrGpuPresent();
+  state.drawsSubmitted = 0;
+  state.drawsCulled = 0;
+  state.frame++;
+  LOVR_ZONE_END();
 }
 
 void lovrGraphicsCreateWindow(WindowFlags* flags) {
@@ -214,6 +261,20 @@ float lovrGraphicsGetPixelDensity() {
   }
 }
 
+// Extracts the world space planes of each eye's frustum (their normals point inwards)
+static void updateFrustum() {
+  for (int i = 0; i < 2; i++) {
+    float m[16];
+    mat4_multiply(mat4_init(m, state.camera.projection[i]), state.camera.viewMatrix[i]);
+    for (int j = 0; j < 3; j++) {
+      for (int k = 0; k < 4; k++) {
+        state.frustum[i][2 * j + 0][k] = m[4 * k + 3] + m[4 * k + j];
+        state.frustum[i][2 * j + 1][k] = m[4 * k + 3] - m[4 * k + j];
+      }
+    }
+  }
+}
+
 void lovrGraphicsSetCamera(Camera* camera, bool clear) {
   lovrGraphicsFlush();
 
@@ -231,6 +292,8 @@ void lovrGraphicsSetCamera(Camera* camera, bool clear) {
     state.camera = *camera;
   }
 
+  updateFrustum();
+
   if (clear) {
     Color background = state.backgroundColor;
     gammaCorrectColor(&background);
@@ -242,6 +305,80 @@ Buffer* lovrGraphicsGetIdentityBuffer() {
   return state.identityBuffer;
 }
 
+bool lovrGraphicsIsFrustumCullingEnabled() {
+  return state.frustumCulling;
+}
+
+void lovrGraphicsSetFrustumCullingEnabled(bool enable) {
+  state.frustumCulling = enable;
+}
+
+void lovrGraphicsGetCullingStats(uint32_t* submitted, uint32_t* culled) {
+  *submitted = state.drawsSubmitted;
+  *culled = state.drawsCulled;
+}
+
+// Counts presented frames
+uint32_t lovrGraphicsGetFrame() {
+  return state.frame;
+}
+
+// Approximates the height of some local bounds on screen, as a fraction of the viewport height, by
+// projecting their bounding sphere from the closest eye
+float lovrGraphicsGetProjectedSize(float bounds[6], mat4 transform) {
+  float m[16];
+  mat4_multiply(mat4_init(m, state.transforms[state.transform]), transform);
+
+  float center[3] = { (bounds[0] + bounds[1]) / 2.f, (bounds[2] + bounds[3]) / 2.f, (bounds[4] + bounds[5]) / 2.f };
+  float extent[3] = { bounds[1] - bounds[0], bounds[3] - bounds[2], bounds[5] - bounds[4] };
+  float scale[3];
+  mat4_transform(m, center);
+  mat4_getScale(m, scale);
+  float radius = vec3_length(extent) / 2.f * MAX(scale[0], MAX(scale[1], scale[2]));
+
+  float size = 0.f;
+  int views = state.camera.stereo ? 2 : 1;
+  for (int i = 0; i < views; i++) {
+    float eye[3];
+    float inverse[16];
+    mat4_invert(mat4_init(inverse, state.camera.viewMatrix[i]));
+    mat4_getPosition(inverse, eye);
+    float distance = vec3_distance(center, eye);
+
+    if (distance <= radius) {
+      return FLT_MAX;
+    }
+
+    size = MAX(size, radius * state.camera.projection[i][5] / distance);
+  }
+
+  return size;
+}
+
+// Creates every default shader that hasn't been used yet and waits for them (and any extra shaders)
+// to finish compiling, so a loading screen can absorb the cost instead of the first frames that draw
+// The multiview variants of the default shaders are warmed too when they can be used
+void lovrGraphicsPrecompileShaders(Shader** shaders, uint32_t count) {
+  int variants = lovrGpuGetFeatures()->multiview ? 2 : 1;
+  for (int i = 0; i < MAX_DEFAULT_SHADERS; i++) {
+    for (int j = 0; j < variants; j++) {
+      if (!state.defaultShaders[i][j]) {
+        state.defaultShaders[i][j] = lovrShaderCreateDefault(i, NULL, 0, j == 1, true);
+      }
+    }
+  }
+
+  for (int i = 0; i < MAX_DEFAULT_SHADERS; i++) {
+    for (int j = 0; j < variants; j++) {
+      lovrShaderWait(state.defaultShaders[i][j]);
+    }
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    lovrShaderWait(shaders[i]);
+  }
+}
+
 // State
 
 void lovrGraphicsReset() {
@@ -448,6 +585,7 @@ void lovrGraphicsMatrixTransform(mat4 transform) {
 void lovrGraphicsSetProjection(mat4 projection) {
   mat4_set(state.camera.projection[0], projection);
   mat4_set(state.camera.projection[1], projection);
+  updateFrustum();
 }
 
 // Rendering
@@ -463,18 +601,99 @@ void lovrGraphicsDiscard(bool color, bool depth, bool stencil) {
   lovrGpuDiscard(state.canvas ? state.canvas : state.camera.canvas, color, depth, stencil);
 }
 
+// Draws without a material use one of a few default materials, keyed by their textures.  Changing
+// the textures of a material flushes any batch using it, so slots used by pending batches are only
+// recycled when every slot is in use.
+static Material* getDefaultMaterial(Texture* diffuse, Texture* environment) {
+  for (int i = 0; i < MAX_DEFAULT_MATERIALS; i++) {
+    Material* material = state.defaultMaterials[i];
+    if (material && material->textures[TEXTURE_DIFFUSE] == diffuse && material->textures[TEXTURE_ENVIRONMENT_MAP] == environment) {
+      return material;
+    }
+  }
+
+  uint32_t slot = state.defaultMaterialCursor;
+  for (int i = 0; i < MAX_DEFAULT_MATERIALS; i++) {
+    uint32_t candidate = (state.defaultMaterialCursor + i) % MAX_DEFAULT_MATERIALS;
+    bool pending = false;
+    for (int j = 0; j < state.batchCount && !pending; j++) {
+      pending = state.batches[j].material == state.defaultMaterials[candidate];
+    }
+
+    if (!state.defaultMaterials[candidate] || !pending) {
+      slot = candidate;
+      break;
+    }
+  }
+
+  state.defaultMaterialCursor = (slot + 1) % MAX_DEFAULT_MATERIALS;
+
+  if (!state.defaultMaterials[slot]) {
+    state.defaultMaterials[slot] = lovrMaterialCreate();
+  }
+
+  Material* material = state.defaultMaterials[slot];
+  lovrMaterialSetTexture(material, TEXTURE_DIFFUSE, diffuse);
+  lovrMaterialSetTexture(material, TEXTURE_ENVIRONMENT_MAP, environment);
+  return material;
+}
+
+// Bounds are { minx, maxx, miny, maxy, minz, maxz } in the local space of the draw.  They're moved to
+// world space as an axis aligned box and tested against the frustum of each eye, and the draw is only
+// culled if the box is fully behind a plane of every eye.
+static bool isCulled(BatchRequest* req) {
+  float m[16];
+  float* b = req->bounds;
+  mat4_init(m, state.transforms[state.transform]);
+  if (req->transform) {
+    mat4_multiply(m, req->transform);
+  }
+
+  float min[3], max[3];
+  for (int i = 0; i < 3; i++) {
+    min[i] = max[i] = m[12 + i];
+    for (int j = 0; j < 3; j++) {
+      float e = m[4 * j + i] * b[2 * j + 0];
+      float f = m[4 * j + i] * b[2 * j + 1];
+      min[i] += MIN(e, f);
+      max[i] += MAX(e, f);
+    }
+  }
+
+  int views = state.camera.stereo ? 2 : 1;
+  for (int i = 0; i < views; i++) {
+    bool outside = false;
+    for (int j = 0; j < 6 && !outside; j++) {
+      float* p = state.frustum[i][j];
+      float x = p[0] > 0.f ? max[0] : min[0];
+      float y = p[1] > 0.f ? max[1] : min[1];
+      float z = p[2] > 0.f ? max[2] : min[2];
+      outside = p[0] * x + p[1] * y + p[2] * z + p[3] < 0.f;
+    }
+
+    if (!outside) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 void lovrGraphicsBatch(BatchRequest* req) {
+  if (state.frustumCulling && req->bounds && isCulled(req)) {
+    state.drawsCulled++;
+    return;
+  }
+
+  state.drawsSubmitted++;
 
   // Resolve objects
   Canvas* canvas = state.canvas ? state.canvas : state.camera.canvas;
-  Shader* shader = state.shader ? state.shader : (state.defaultShaders[req->shader] ? state.defaultShaders[req->shader] : (state.defaultShaders[req->shader] = lovrShaderCreateDefault(req->shader, NULL, 0)));
+  bool multiview = canvas && canvas->flags.multiview;
+  Shader** defaultShader = &state.defaultShaders[req->shader][multiview];
+  Shader* shader = state.shader ? lovrShaderGetVariant(state.shader, multiview) : (*defaultShader ? *defaultShader : (*defaultShader = lovrShaderCreateDefault(req->shader, NULL, 0, multiview, false)));
   Pipeline* pipeline = req->pipeline ? req->pipeline : &state.pipeline;
-  Material* material = req->material ? req->material : (state.defaultMaterial ? state.defaultMaterial : (state.defaultMaterial = lovrMaterialCreate()));
-
-  if (!req->material) {
-    lovrMaterialSetTexture(material, TEXTURE_DIFFUSE, req->diffuseTexture);
-    lovrMaterialSetTexture(material, TEXTURE_ENVIRONMENT_MAP, req->environmentMap);
-  }
+  Material* material = req->material ? req->material : getDefaultMaterial(req->diffuseTexture, req->environmentMap);
 
   if (lovrShaderHasUniform(shader, "lovrPose")) {
     if (req->type == BATCH_MESH && req->params.mesh.pose) {
@@ -486,13 +705,16 @@ void lovrGraphicsBatch(BatchRequest* req) {
 
   // Try to find an existing batch to use
   Batch* batch = NULL;
-  if (req->type != BATCH_MESH || req->params.mesh.instances == 1) {
+  bool instanceData = req->type == BATCH_MESH && req->params.mesh.instanceData;
+  bool indirect = req->type == BATCH_MESH && req->params.mesh.indirectBuffer;
+  bool multiDraw = req->type == BATCH_MESH && req->params.mesh.instances == 1 && !instanceData && !indirect && lovrGpuGetFeatures()->multiDraw;
+  if (req->type != BATCH_MESH || (req->params.mesh.instances == 1 && !instanceData && !indirect)) {
     for (int i = state.batchCount - 1; i >= 0; i--) {
       Batch* b = &state.batches[i];
 
       if (b->count >= MAX_DRAWS) { goto next; }
-      if (!areBatchParamsEqual(req->type, b->type, &req->params, &b->params)) { goto next; }
-      if (b->canvas == canvas && b->shader == shader && !memcmp(&b->pipeline, pipeline, sizeof(Pipeline)) && b->material == material) {
+      if (!areBatchParamsEqual(req->type, b->type, &req->params, &b->params, b->commands != NULL)) { goto next; }
+      if (b->canvas == canvas && b->shader == shader && !memcmp(&b->pipeline, pipeline, sizeof(Pipeline)) && areMaterialTexturesEqual(b->material, material)) {
         batch = b;
         break;
       }
@@ -532,6 +754,8 @@ next:
 
     float* transforms = lovrGraphicsMapBuffer(STREAM_TRANSFORM, MAX_DRAWS);
     Color* colors = lovrGraphicsMapBuffer(STREAM_COLOR, MAX_DRAWS);
+    float* materials = lovrGraphicsMapBuffer(STREAM_MATERIAL, MAX_DRAWS);
+    uint32_t* commands = multiDraw ? lovrGraphicsMapBuffer(STREAM_INDIRECT, MAX_DRAWS) : NULL;
 
     batch = &state.batches[state.batchCount++];
     *batch = (Batch) {
@@ -544,6 +768,8 @@ next:
       .material = material,
       .transforms = transforms,
       .colors = colors,
+      .materials = materials,
+      .commands = commands,
       .instanced = req->instanced
     };
 
@@ -553,12 +779,28 @@ next:
 
     batch->cursors[STREAM_TRANSFORM].count = MAX_DRAWS;
     batch->cursors[STREAM_COLOR].count = MAX_DRAWS;
+    batch->cursors[STREAM_MATERIAL].count = MAX_DRAWS;
     state.cursors[STREAM_TRANSFORM] += MAX_DRAWS;
     state.cursors[STREAM_COLOR] += MAX_DRAWS;
+    state.cursors[STREAM_MATERIAL] += MAX_DRAWS;
+
+    if (commands) {
+      batch->cursors[STREAM_INDIRECT].count = MAX_DRAWS;
+      state.cursors[STREAM_INDIRECT] += MAX_DRAWS;
+    }
+  }
+
+  // Instance data is written ahead of time (see lovrGraphicsWriteInstances), so the batch just
+  // references its range instead of claiming a new one
+  if (instanceData) {
+    batch->cursors[STREAM_INSTANCE].start = req->params.mesh.instanceStart;
+    batch->cursors[STREAM_INSTANCE].count = req->params.mesh.instances;
   }
 
   // Transform
-  if (req->transform) {
+  if (instanceData) {
+    memcpy(&batch->transforms[16 * batch->count], req->transform ? req->transform : (float[]) MAT4_IDENTITY, 16 * sizeof(float));
+  } else if (req->transform) {
     float transform[16];
     mat4_multiply(mat4_init(transform, state.transforms[state.transform]), req->transform);
     memcpy(&batch->transforms[16 * batch->count], transform, 16 * sizeof(float));
@@ -571,6 +813,27 @@ next:
   gammaCorrectColor(&color);
   batch->colors[batch->count] = color;
 
+  // Material
+  memcpy(&batch->materials[MATERIAL_BLOCK_FLOATS * batch->count], lovrMaterialGetBlock(material), MATERIAL_BLOCK_FLOATS * sizeof(float));
+
+  // Indirect command, the base instance selects the draw's ID.  Singlepass stereo draws every view as
+  // an instance, so the instance count is the number of views.
+  if (batch->commands) {
+    Mesh* mesh = req->params.mesh.object;
+    uint32_t* command = &batch->commands[5 * batch->count];
+    bool stereo = canvas ? lovrCanvasIsStereo(canvas) : state.camera.stereo;
+    uint32_t views = lovrGpuGetFeatures()->singlepass && stereo && !multiview ? 2 : 1;
+    int32_t baseVertex;
+    lovrMeshGetBaseVertex(batch->params.mesh.object, mesh, &baseVertex);
+    if (mesh->indexCount > 0) {
+      uint32_t firstIndex = (uint32_t) (mesh->indexOffset / mesh->indexSize) + req->params.mesh.rangeStart;
+      memcpy(command, (uint32_t[5]) { req->params.mesh.rangeCount, views, firstIndex, (uint32_t) baseVertex, batch->count }, 5 * sizeof(uint32_t));
+    } else {
+      uint32_t first = (uint32_t) ((int64_t) req->params.mesh.rangeStart + baseVertex);
+      memcpy(command, (uint32_t[5]) { req->params.mesh.rangeCount, views, first, batch->count, 0 }, 5 * sizeof(uint32_t));
+    }
+  }
+
   if (!req->instanced || batch->count == 0) {
     batch->cursors[STREAM_VERTEX].count += req->vertexCount;
     batch->cursors[STREAM_INDEX].count += req->indexCount;
@@ -584,22 +847,63 @@ next:
   batch->count++;
 }
 
+// Instance transforms already include the transform stack, so the draw's own transform is applied
+// in model space (see lovrModel in the vertex shader).  The data is written once and can be shared by
+// several mesh draws through their instanceStart, until the next call.
+uint32_t lovrGraphicsWriteInstances(float* transforms, float* colors, uint32_t count) {
+  float* instances = lovrGraphicsMapBuffer(STREAM_INSTANCE, count);
+  mat4 stack = state.transforms[state.transform];
+  bool identity = !memcmp(stack, (float[]) MAT4_IDENTITY, 16 * sizeof(float));
+
+  for (uint32_t i = 0; i < count; i++, instances += 20) {
+    if (identity) {
+      memcpy(instances, transforms + 16 * i, 16 * sizeof(float));
+    } else {
+      mat4_multiply(mat4_init(instances, stack), transforms + 16 * i);
+    }
+
+    if (colors) {
+      Color color = { colors[4 * i + 0], colors[4 * i + 1], colors[4 * i + 2], colors[4 * i + 3] };
+      gammaCorrectColor(&color);
+      memcpy(instances + 16, &color, 4 * sizeof(float));
+    } else {
+      memcpy(instances + 16, (float[4]) { 1.f, 1.f, 1.f, 1.f }, 4 * sizeof(float));
+    }
+  }
+
+  // The range is flushed now, since a flush can happen before any batch refers to it
+  uint32_t start = state.cursors[STREAM_INSTANCE];
+  lovrBufferFlush(state.buffers[STREAM_INSTANCE], start * BUFFER_STRIDES[STREAM_INSTANCE], count * BUFFER_STRIDES[STREAM_INSTANCE]);
+  state.cursors[STREAM_INSTANCE] += count;
+  return start;
+}
+
 void lovrGraphicsFlush() {
   if (state.batchCount == 0) {
     return;
   }
 
+  LOVR_ZONE_BEGIN("lovrGraphicsFlush");
+
   // Prevent infinite flushing >_>
   int batchCount = state.batchCount;
   state.batchCount = 0;
 
-  // Flush buffers
-  Batch* firstBatch = &state.batches[0];
-  Batch* lastBatch = &state.batches[batchCount - 1];
+  // Flush buffers.  Batches can share instance data, so their ranges aren't necessarily in order.
   for (int i = 0; i < MAX_BUFFER_ROLES; i++) {
-    size_t offset = firstBatch->cursors[i].start * BUFFER_STRIDES[i];
-    size_t size = (lastBatch->cursors[i].start + lastBatch->cursors[i].count - firstBatch->cursors[i].start) * BUFFER_STRIDES[i];
-    lovrBufferFlush(state.buffers[i], offset, size);
+    uint32_t start = UINT32_MAX;
+    uint32_t end = 0;
+    for (int b = 0; b < batchCount; b++) {
+      uint32_t batchStart = state.batches[b].cursors[i].start;
+      uint32_t batchEnd = batchStart + state.batches[b].cursors[i].count;
+      if (batchEnd > batchStart) {
+        start = MIN(start, batchStart);
+        end = MAX(end, batchEnd);
+      }
+    }
+    if (end > start) {
+      lovrBufferFlush(state.buffers[i], start * BUFFER_STRIDES[i], (end - start) * BUFFER_STRIDES[i]);
+    }
     lovrBufferUnmap(state.buffers[i]);
   }
 
@@ -612,6 +916,7 @@ void lovrGraphicsFlush() {
     // Bind UBOs
     lovrShaderSetBlock(batch->shader, "lovrModelBlock", state.buffers[STREAM_TRANSFORM], batch->cursors[STREAM_TRANSFORM].start * BUFFER_STRIDES[STREAM_TRANSFORM], MAX_DRAWS * BUFFER_STRIDES[STREAM_TRANSFORM], ACCESS_READ);
     lovrShaderSetBlock(batch->shader, "lovrColorBlock", state.buffers[STREAM_COLOR], batch->cursors[STREAM_COLOR].start * BUFFER_STRIDES[STREAM_COLOR], MAX_DRAWS * BUFFER_STRIDES[STREAM_COLOR], ACCESS_READ);
+    lovrShaderSetBlock(batch->shader, "lovrMaterialBlock", state.buffers[STREAM_MATERIAL], batch->cursors[STREAM_MATERIAL].start * BUFFER_STRIDES[STREAM_MATERIAL], MAX_DRAWS * BUFFER_STRIDES[STREAM_MATERIAL], ACCESS_READ);
 
     // Uniforms
     lovrMaterialBind(batch->material, batch->shader);
@@ -623,10 +928,33 @@ void lovrGraphicsFlush() {
     }
 
     uint32_t rangeStart, rangeCount;
+    Buffer* indirectBuffer = NULL;
+    size_t indirectOffset = 0;
+    uint32_t indirectCount = 0;
+    uint32_t indirectStride = 0;
+    Buffer* instanceBuffer = NULL;
+    size_t instanceOffset = 0;
     if (batch->type == BATCH_MESH) {
       rangeStart = params->mesh.rangeStart;
       rangeCount = params->mesh.rangeCount;
-      if (params->mesh.instances > 1) {
+      if (params->mesh.indirectBuffer) {
+        lovrMeshSetAttributeEnabled(mesh, "lovrDrawID", false);
+        indirectBuffer = params->mesh.indirectBuffer;
+        indirectOffset = params->mesh.indirectOffset;
+        indirectCount = params->mesh.indirectCount;
+        indirectStride = params->mesh.indirectStride;
+      } else if (batch->commands) {
+        lovrMeshSetAttributeEnabled(mesh, "lovrDrawID", true);
+        indirectBuffer = state.buffers[STREAM_INDIRECT];
+        indirectOffset = batch->cursors[STREAM_INDIRECT].start * BUFFER_STRIDES[STREAM_INDIRECT];
+        indirectCount = batch->count;
+        indirectStride = BUFFER_STRIDES[STREAM_INDIRECT];
+      } else if (batch->cursors[STREAM_INSTANCE].count > 0) {
+        lovrMeshSetAttributeEnabled(mesh, "lovrDrawID", false);
+        instanceBuffer = state.buffers[STREAM_INSTANCE];
+        instanceOffset = batch->cursors[STREAM_INSTANCE].start * BUFFER_STRIDES[STREAM_INSTANCE];
+        instances = batch->cursors[STREAM_INSTANCE].count;
+      } else if (params->mesh.instances > 1) {
         lovrMeshSetAttributeEnabled(mesh, "lovrDrawID", false);
         instances = params->mesh.instances;
       } else {
@@ -654,6 +982,12 @@ void lovrGraphicsFlush() {
       .instances = instances,
       .rangeStart = rangeStart,
       .rangeCount = rangeCount,
+      .indirectBuffer = indirectBuffer,
+      .indirectOffset = indirectOffset,
+      .indirectCount = indirectCount,
+      .indirectStride = indirectStride,
+      .instanceBuffer = instanceBuffer,
+      .instanceOffset = instanceOffset,
       .width = batch->canvas ? lovrCanvasGetWidth(batch->canvas) : state.width,
       .height = batch->canvas ? lovrCanvasGetHeight(batch->canvas) : state.height,
       .stereo = batch->type != BATCH_FILL && (batch->canvas ? lovrCanvasIsStereo(batch->canvas) : state.camera.stereo)
@@ -668,11 +1002,16 @@ void lovrGraphicsFlush() {
         size_t firstLock = start / lockSize;
         size_t lastLock = MIN(start + count, BUFFER_COUNTS[i] - 1) / lockSize;
         for (size_t j = firstLock; j < lastLock; j++) {
+          if (state.locks[i][j]) {
+            lovrGpuDestroyLock(state.locks[i][j]);
+          }
           state.locks[i][j] = lovrGpuLock();
         }
       }
     }
   }
+
+  LOVR_ZONE_END();
 }
 
 void lovrGraphicsFlushCanvas(Canvas* canvas) {
@@ -783,9 +1122,14 @@ void lovrGraphicsPlane(DrawStyle style, Material* material, mat4 transform, floa
     .indexCount = style == STYLE_LINE ? 5 : 6,
     .vertices = &vertices,
     .indices = &indices,
-    .baseVertex = &baseVertex
+    .baseVertex = &baseVertex,
+    .bounds = (float[6]) { -.5f, .5f, -.5f, .5f, 0.f, 0.f }
   });
 
+  if (!vertices) {
+    return;
+  }
+
   if (style == STYLE_LINE) {
     static float vertexData[] = {
       -.5f,  .5f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f,
@@ -835,6 +1179,7 @@ void lovrGraphicsBox(DrawStyle style, Material* material, mat4 transform) {
     .vertices = &vertices,
     .indices = &indices,
     .baseVertex = &baseVertex,
+    .bounds = (float[6]) { -.5f, .5f, -.5f, .5f, -.5f, .5f },
     .instanced = true
   });
 
@@ -933,6 +1278,7 @@ void lovrGraphicsArc(DrawStyle style, ArcMode mode, Material* material, mat4 tra
     .transform = transform,
     .vertexCount = vertexCount,
     .vertices = &vertices,
+    .bounds = (float[6]) { -1.f, 1.f, -1.f, 1.f, 0.f, 0.f },
     .instanced = true
   });
 
@@ -964,6 +1310,7 @@ void lovrGraphicsCylinder(Material* material, mat4 transform, float r1, float r2
   r1 /= length;
   r2 /= length;
 
+  float r = MAX(r1, r2);
   uint32_t vertexCount = ((capped && r1) * (segments + 2) + (capped && r2) * (segments + 2) + 2 * (segments + 1));
   uint32_t indexCount = 3 * segments * ((capped && r1) + (capped && r2) + 2);
   float* vertices = NULL;
@@ -984,6 +1331,7 @@ void lovrGraphicsCylinder(Material* material, mat4 transform, float r1, float r2
     .vertices = &vertices,
     .indices = &indices,
     .baseVertex = &baseVertex,
+    .bounds = (float[6]) { -r, r, -r, r, -.5f, .5f },
     .instanced = true
   });
 
@@ -1061,6 +1409,7 @@ void lovrGraphicsSphere(Material* material, mat4 transform, int segments) {
     .vertices = &vertices,
     .indices = &indices,
     .baseVertex = &baseVertex,
+    .bounds = (float[6]) { -1.f, 1.f, -1.f, 1.f, -1.f, 1.f },
     .instanced = true
   });
 
@@ -1191,3 +1540,36 @@ void lovrGraphicsFill(Texture* texture, float u, float v, float w, float h) {
     }, 32 * sizeof(float));
   }
 }
+
+// The command buffer is usually written by a compute shader, so the draw is flushed right away to
+// keep it ordered with later dispatches and to avoid holding on to the buffer
+void lovrGraphicsDrawIndirect(Mesh* mesh, mat4 transform, Buffer* buffer, size_t offset, uint32_t count, uint32_t stride) {
+  const GpuFeatures* features = lovrGpuGetFeatures();
+  bool indexed = lovrMeshGetIndexCount(mesh) > 0;
+  uint32_t size = (indexed ? 5 : 4) * sizeof(uint32_t);
+  stride = stride ? stride : size;
+  lovrAssert(features->indirect, "Indirect drawing is not supported on this system");
+  lovrAssert(offset % 4 == 0 && stride % 4 == 0, "Indirect command offset and stride must be multiples of 4");
+  size_t bufferSize = lovrBufferGetSize(buffer);
+  lovrAssert(count > 0, "Indirect draw count must be positive");
+  lovrAssert(offset <= bufferSize && size <= bufferSize - offset, "Tried to read indirect commands past the end of the buffer");
+  lovrAssert((size_t) (count - 1) <= (bufferSize - offset - size) / stride, "Tried to read indirect commands past the end of the buffer");
+
+  lovrGraphicsBatch(&(BatchRequest) {
+    .type = BATCH_MESH,
+    .params.mesh = {
+      .object = mesh,
+      .mode = lovrMeshGetDrawMode(mesh),
+      .instances = 1,
+      .indirectBuffer = buffer,
+      .indirectOffset = offset,
+      .indirectCount = count,
+      .indirectStride = stride
+    },
+    .drawMode = lovrMeshGetDrawMode(mesh),
+    .transform = transform,
+    .material = lovrMeshGetMaterial(mesh)
+  });
+
+  lovrGraphicsFlush();
+}
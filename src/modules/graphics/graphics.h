@@ -12,6 +12,9 @@
 #define MAX_BATCHES 16
 #define MAX_DRAWS 256
 #define MAX_LOCKS 4
+#define MAX_INSTANCES (1 << 16)
+#define MAX_DEFAULT_MATERIALS 8
+#define MAX_TIMER_PASSES 32
 
 struct Buffer;
 struct Canvas;
@@ -106,6 +109,9 @@ typedef enum {
   STREAM_DRAW_ID,
   STREAM_TRANSFORM,
   STREAM_COLOR,
+  STREAM_MATERIAL,
+  STREAM_INSTANCE,
+  STREAM_INDIRECT,
   MAX_BUFFER_ROLES
 } BufferRole;
 
@@ -132,7 +138,7 @@ typedef union {
   struct { float r1; float r2; bool capped; int segments; } cylinder;
   struct { int segments; } sphere;
   struct { float u; float v; float w; float h; } fill;
-  struct { struct Mesh* object; DrawMode mode; uint32_t rangeStart; uint32_t rangeCount; uint32_t instances; float* pose; } mesh;
+  struct { struct Mesh* object; DrawMode mode; uint32_t rangeStart; uint32_t rangeCount; uint32_t instances; float* pose; bool instanceData; uint32_t instanceStart; struct Buffer* indirectBuffer; size_t indirectOffset; uint32_t indirectCount; uint32_t indirectStride; } mesh;
 } BatchParams;
 
 typedef struct {
@@ -150,6 +156,7 @@ typedef struct {
   float** vertices;
   uint16_t** indices;
   uint16_t* baseVertex;
+  float* bounds;
   bool instanced;
 } BatchRequest;
 
@@ -163,6 +170,8 @@ typedef struct {
   struct Material* material;
   mat4 transforms;
   Color* colors;
+  float* materials;
+  uint32_t* commands;
   struct { uint32_t start; uint32_t count; } cursors[MAX_BUFFER_ROLES];
   uint32_t count;
   bool instanced;
@@ -173,8 +182,9 @@ typedef struct {
   int width;
   int height;
   Camera camera;
-  struct Shader* defaultShaders[MAX_DEFAULT_SHADERS];
-  struct Material* defaultMaterial;
+  struct Shader* defaultShaders[MAX_DEFAULT_SHADERS][2];
+  struct Material* defaultMaterials[MAX_DEFAULT_MATERIALS];
+  uint32_t defaultMaterialCursor;
   struct Font* defaultFont;
   TextureFilter defaultFilter;
   float transforms[MAX_TRANSFORMS][16];
@@ -194,6 +204,11 @@ typedef struct {
   void* locks[MAX_BUFFER_ROLES][MAX_LOCKS];
   Batch batches[MAX_BATCHES];
   uint8_t batchCount;
+  bool frustumCulling;
+  float frustum[2][6][4];
+  uint32_t drawsSubmitted;
+  uint32_t drawsCulled;
+  uint32_t frame;
 } GraphicsState;
 
 // Base
@@ -206,9 +221,17 @@ int lovrGraphicsGetHeight(void);
 float lovrGraphicsGetPixelDensity(void);
 void lovrGraphicsSetCamera(Camera* camera, bool clear);
 struct Buffer* lovrGraphicsGetIdentityBuffer(void);
+bool lovrGraphicsIsFrustumCullingEnabled(void);
+void lovrGraphicsSetFrustumCullingEnabled(bool enable);
+void lovrGraphicsGetCullingStats(uint32_t* submitted, uint32_t* culled);
+uint32_t lovrGraphicsGetFrame(void);
+float lovrGraphicsGetProjectedSize(float bounds[6], mat4 transform);
+void lovrGraphicsPrecompileShaders(struct Shader** shaders, uint32_t count);
 #define lovrGraphicsGetFeatures lovrGpuGetFeatures
 #define lovrGraphicsGetLimits lovrGpuGetLimits
 #define lovrGraphicsGetStats lovrGpuGetStats
+#define lovrGraphicsIsTimingEnabled lovrGpuIsTimingEnabled
+#define lovrGraphicsSetTimingEnabled lovrGpuSetTimingEnabled
 
 // State
 void lovrGraphicsReset(void);
@@ -257,6 +280,7 @@ void lovrGraphicsSetProjection(mat4 projection);
 void lovrGraphicsClear(Color* color, float* depth, int* stencil);
 void lovrGraphicsDiscard(bool color, bool depth, bool stencil);
 void lovrGraphicsBatch(BatchRequest* req);
+uint32_t lovrGraphicsWriteInstances(float* transforms, float* colors, uint32_t count);
 void lovrGraphicsFlush(void);
 void lovrGraphicsFlushCanvas(struct Canvas* canvas);
 void lovrGraphicsFlushShader(struct Shader* shader);
@@ -274,6 +298,7 @@ void lovrGraphicsSphere(struct Material* material, mat4 transform, int segments)
 void lovrGraphicsSkybox(struct Texture* texture, float angle, float ax, float ay, float az);
 void lovrGraphicsPrint(const char* str, size_t length, mat4 transform, float wrap, HorizontalAlign halign, VerticalAlign valign);
 void lovrGraphicsFill(struct Texture* texture, float u, float v, float w, float h);
+void lovrGraphicsDrawIndirect(struct Mesh* mesh, mat4 transform, struct Buffer* buffer, size_t offset, uint32_t count, uint32_t stride);
 #define lovrGraphicsStencil lovrGpuStencil
 #define lovrGraphicsCompute lovrGpuCompute
 
@@ -282,6 +307,10 @@ void lovrGraphicsFill(struct Texture* texture, float u, float v, float w, float
 typedef struct {
   bool compute;
   bool singlepass;
+  bool timers;
+  bool indirect;
+  bool multiDraw;
+  bool multiview;
 } GpuFeatures;
 
 typedef struct {
@@ -294,9 +323,26 @@ typedef struct {
   int blockAlign;
 } GpuLimits;
 
+typedef enum {
+  TIMER_DRAW,
+  TIMER_COMPUTE,
+  TIMER_RESOLVE,
+  TIMER_PASS,
+  MAX_GPU_TIMERS
+} GpuTimerType;
+
+typedef struct {
+  bool valid;
+  double total;
+  double times[MAX_GPU_TIMERS];
+  double passes[MAX_TIMER_PASSES];
+  uint32_t passCount;
+} GpuTimings;
+
 typedef struct {
   int shaderSwitches;
   int drawCalls;
+  GpuTimings timings;
 } GpuStats;
 
 typedef struct {
@@ -308,6 +354,12 @@ typedef struct {
   uint32_t instances;
   uint32_t rangeStart;
   uint32_t rangeCount;
+  struct Buffer* indirectBuffer;
+  size_t indirectOffset;
+  uint32_t indirectCount;
+  uint32_t indirectStride;
+  struct Buffer* instanceBuffer;
+  size_t instanceOffset;
   uint32_t width : 15;
   uint32_t height : 15;
   bool stereo : 1;
@@ -322,6 +374,8 @@ void lovrGpuDraw(DrawCommand* draw);
 void lovrGpuStencil(StencilAction action, int replaceValue, StencilCallback callback, void* userdata);
 void lovrGpuPresent(void);
 void lovrGpuDirtyTexture(void);
+bool lovrGpuIsTimingEnabled(void);
+void lovrGpuSetTimingEnabled(bool enable);
 void* lovrGpuLock(void);
 void lovrGpuUnlock(void* lock);
 void lovrGpuDestroyLock(void* lock);
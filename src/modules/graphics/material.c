@@ -2,8 +2,10 @@
 #include "graphics/graphics.h"
 #include "graphics/shader.h"
 #include "graphics/texture.h"
+#include "math/math.h"
 #include "resources/shaders.h"
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 Material* lovrMaterialInit(Material* material) {
@@ -31,20 +33,39 @@ void lovrMaterialDestroy(void* ref) {
   }
 }
 
+// Scalars, colors, and the transform are copied into the per-draw material block (see
+// lovrMaterialGetBlock) when a draw is batched, so only the textures are bound here
 void lovrMaterialBind(Material* material, Shader* shader) {
-  for (int i = 0; i < MAX_MATERIAL_SCALARS; i++) {
-    lovrShaderSetFloats(shader, lovrShaderScalarUniforms[i], &material->scalars[i], 0, 1);
-  }
-
-  for (int i = 0; i < MAX_MATERIAL_COLORS; i++) {
-    lovrShaderSetColor(shader, lovrShaderColorUniforms[i], material->colors[i]);
-  }
-
   for (int i = 0; i < MAX_MATERIAL_TEXTURES; i++) {
     lovrShaderSetTextures(shader, lovrShaderTextureUniforms[i], &material->textures[i], 0, 1);
   }
+}
 
-  lovrShaderSetMatrices(shader, "lovrMaterialTransform", material->transform, 0, 9);
+// std140 layout of lovrMaterialData: diffuse color, emissive color, (metalness, roughness, offset),
+// and the 2x2 part of the transform.  It's only repacked after the material changes.  Colors are
+// converted to linear space, like the ones set with lovrShaderSetColor.
+const float* lovrMaterialGetBlock(Material* material) {
+  if (material->dirty) {
+    float* block = material->block;
+    for (int i = 0; i < 2; i++) {
+      Color color = material->colors[i == 0 ? COLOR_DIFFUSE : COLOR_EMISSIVE];
+      block[4 * i + 0] = lovrMathGammaToLinear(color.r);
+      block[4 * i + 1] = lovrMathGammaToLinear(color.g);
+      block[4 * i + 2] = lovrMathGammaToLinear(color.b);
+      block[4 * i + 3] = color.a;
+    }
+    block[8] = material->scalars[SCALAR_METALNESS];
+    block[9] = material->scalars[SCALAR_ROUGHNESS];
+    block[10] = material->transform[6];
+    block[11] = material->transform[7];
+    block[12] = material->transform[0];
+    block[13] = material->transform[1];
+    block[14] = material->transform[3];
+    block[15] = material->transform[4];
+    material->dirty = false;
+  }
+
+  return material->block;
 }
 
 float lovrMaterialGetScalar(Material* material, MaterialScalar scalarType) {
@@ -53,8 +74,8 @@ float lovrMaterialGetScalar(Material* material, MaterialScalar scalarType) {
 
 void lovrMaterialSetScalar(Material* material, MaterialScalar scalarType, float value) {
   if (material->scalars[scalarType] != value) {
-    lovrGraphicsFlushMaterial(material);
     material->scalars[scalarType] = value;
+    material->dirty = true;
   }
 }
 
@@ -64,8 +85,8 @@ Color lovrMaterialGetColor(Material* material, MaterialColor colorType) {
 
 void lovrMaterialSetColor(Material* material, MaterialColor colorType, Color color) {
   if (memcmp(&material->colors[colorType], &color, 4 * sizeof(float))) {
-    lovrGraphicsFlushMaterial(material);
     material->colors[colorType] = color;
+    material->dirty = true;
   }
 }
 
@@ -91,7 +112,6 @@ void lovrMaterialGetTransform(Material* material, float* ox, float* oy, float* s
 }
 
 void lovrMaterialSetTransform(Material* material, float ox, float oy, float sx, float sy, float angle) {
-  lovrGraphicsFlushMaterial(material);
   float c = cosf(angle);
   float s = sinf(angle);
   material->transform[0] = c * sx;
@@ -103,4 +123,5 @@ void lovrMaterialSetTransform(Material* material, float ox, float oy, float sx,
   material->transform[6] = ox;
   material->transform[7] = oy;
   material->transform[8] = 1.f;
+  material->dirty = true;
 }
@@ -3,6 +3,8 @@
 
 #pragma once
 
+#define MATERIAL_BLOCK_FLOATS 16
+
 struct Texture;
 struct Shader;
 
@@ -11,12 +13,15 @@ typedef struct Material {
   Color colors[MAX_MATERIAL_COLORS];
   struct Texture* textures[MAX_MATERIAL_TEXTURES];
   float transform[9];
+  float block[MATERIAL_BLOCK_FLOATS];
+  bool dirty;
 } Material;
 
 Material* lovrMaterialInit(Material* material);
 #define lovrMaterialCreate() lovrMaterialInit(lovrAlloc(Material))
 void lovrMaterialDestroy(void* ref);
 void lovrMaterialBind(Material* material, struct Shader* shader);
+const float* lovrMaterialGetBlock(Material* material);
 float lovrMaterialGetScalar(Material* material, MaterialScalar scalarType);
 void lovrMaterialSetScalar(Material* material, MaterialScalar scalarType, float value);
 Color lovrMaterialGetColor(Material* material, MaterialColor colorType);
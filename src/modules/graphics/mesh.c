@@ -76,6 +76,72 @@ void lovrMeshSetAttributeEnabled(Mesh* mesh, const char* name, bool enable) {
   }
 }
 
+// Draw IDs and instance data are rebound by the renderer for every batch, so they aren't compared
+static bool isRendererAttribute(const char* name) {
+  return !strcmp(name, "lovrDrawID") || !strncmp(name, "lovrInstance", strlen("lovrInstance"));
+}
+
+// Returns whether other can be drawn using mesh's vertex bindings, which is the case when both read
+// the same buffers in the same format and other's vertices are just shifted by a constant amount.
+// That amount is written to baseVertex.
+bool lovrMeshGetBaseVertex(Mesh* mesh, Mesh* other, int32_t* baseVertex) {
+  static const uint32_t typeSizes[] = { [I8] = 1, [U8] = 1, [I16] = 2, [U16] = 2, [I32] = 4, [U32] = 4, [F32] = 4 };
+
+  *baseVertex = 0;
+  if (mesh == other) {
+    return true;
+  }
+
+  if (mesh->indexBuffer != other->indexBuffer || mesh->indexSize != other->indexSize || (mesh->indexCount > 0) != (other->indexCount > 0)) {
+    return false;
+  }
+
+  uint32_t count = 0;
+  bool shifted = false;
+  for (uint32_t i = 0; i < mesh->attributeCount; i++) {
+    MeshAttribute* a = &mesh->attributes[i];
+    if (a->disabled || isRendererAttribute(mesh->attributeNames[i])) {
+      continue;
+    }
+
+    int* index = map_get(&other->attributeMap, mesh->attributeNames[i]);
+    if (!index) {
+      return false;
+    }
+
+    MeshAttribute* b = &other->attributes[*index];
+    if (
+      b->disabled || a->buffer != b->buffer || a->stride != b->stride || a->divisor != b->divisor ||
+      a->type != b->type || a->components != b->components || a->normalized != b->normalized || a->integer != b->integer
+    ) {
+      return false;
+    }
+
+    count++;
+    int64_t difference = (int64_t) b->offset - (int64_t) a->offset;
+    if (a->divisor > 0) {
+      if (difference != 0) return false;
+      continue;
+    }
+
+    int64_t stride = a->stride ? a->stride : a->components * typeSizes[a->type];
+    if (difference % stride != 0 || (shifted && difference / stride != *baseVertex)) {
+      return false;
+    }
+
+    *baseVertex = (int32_t) (difference / stride);
+    shifted = true;
+  }
+
+  for (uint32_t i = 0; i < other->attributeCount; i++) {
+    if (!other->attributes[i].disabled && !isRendererAttribute(other->attributeNames[i])) {
+      count--;
+    }
+  }
+
+  return count == 0;
+}
+
 DrawMode lovrMeshGetDrawMode(Mesh* mesh) {
   return mesh->mode;
 }
@@ -7,6 +7,7 @@
 
 #define MAX_ATTRIBUTES 16
 #define MAX_ATTRIBUTE_NAME_LENGTH 32
+#define INSTANCE_STRIDE (20 * sizeof(float))
 
 struct Buffer;
 struct Material;
@@ -58,6 +59,7 @@ void lovrMeshDetachAttribute(Mesh* mesh, const char* name);
 const MeshAttribute* lovrMeshGetAttribute(Mesh* mesh, const char* name);
 bool lovrMeshIsAttributeEnabled(Mesh* mesh, const char* name);
 void lovrMeshSetAttributeEnabled(Mesh* mesh, const char* name, bool enabled);
+bool lovrMeshGetBaseVertex(Mesh* mesh, Mesh* other, int32_t* baseVertex);
 DrawMode lovrMeshGetDrawMode(Mesh* mesh);
 void lovrMeshSetDrawMode(Mesh* mesh, DrawMode mode);
 void lovrMeshGetDrawRange(Mesh* mesh, uint32_t* start, uint32_t* count);
@@ -6,29 +6,85 @@
 #include "graphics/mesh.h"
 #include "resources/shaders.h"
 #include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOD_GRID 32
+#define LOD_SIZE .25f
+#define LOD_HYSTERESIS .1f
+
+// Global node transforms are cached in model space and stored in the same order as nodeOrder, where
+// parents always come before their children.  A node only needs to be recomputed when its parent
+// changed or the animator changed its local transform, so static models never do any work here.
+static void updateGlobalNodeTransforms(Model* model) {
+  for (uint32_t i = 0; i < model->nodeOrderCount; i++) {
+    uint32_t index = model->nodeOrder[i];
+    uint32_t parent = model->nodeParents[index];
+    mat4 localTransform = model->localNodeTransforms + 16 * index;
+    bool dirty = !model->transformsValid || (parent != ~0u && model->dirtyNodes[parent]);
+
+    if (model->animatedNodes[index] && (model->animator || !model->transformsValid)) {
+      float transform[16] = MAT4_IDENTITY;
+      if (model->animator) {
+        lovrAnimatorEvaluate(model->animator, index, transform);
+      } else {
+        mat4_multiply(transform, model->data->nodes[index].transform);
+      }
 
-static void updateGlobalNodeTransform(Model* model, uint32_t nodeIndex, mat4 transform) {
-  ModelNode* node = &model->data->nodes[nodeIndex];
+      if (memcmp(transform, localTransform, 16 * sizeof(float))) {
+        mat4_set(localTransform, transform);
+        dirty = true;
+      }
+    }
 
-  mat4 globalTransform = model->globalNodeTransforms + 16 * nodeIndex;
-  mat4_set(globalTransform, transform);
+    model->dirtyNodes[index] = dirty;
 
-  if (model->animator) {
-    lovrAnimatorEvaluate(model->animator, nodeIndex, globalTransform);
-  } else {
-    mat4_multiply(globalTransform, node->transform);
+    if (dirty) {
+      mat4 globalTransform = model->globalNodeTransforms + 16 * index;
+      if (parent == ~0u) {
+        mat4_set(globalTransform, localTransform);
+      } else {
+        mat4_multiply(mat4_set(globalTransform, model->globalNodeTransforms + 16 * parent), localTransform);
+      }
+    }
   }
 
-  for (uint32_t i = 0; i < node->childCount; i++) {
-    updateGlobalNodeTransform(model, node->children[i], globalTransform);
+  model->transformsValid = true;
+}
+
+// Level k is used once the node is smaller than LOD_SIZE / 2^k of the screen.  The threshold moves
+// away from the current level a bit so nodes sitting right at a threshold don't flicker between levels,
+// unless the model is drawn several times per frame (see lovrModelDraw).
+static uint32_t selectLevel(Model* model, uint32_t nodeIndex, mat4 transform) {
+  float* bounds = model->nodeBounds + 6 * nodeIndex;
+  if (bounds[0] > bounds[1]) {
+    return 0;
   }
+
+  uint32_t current = model->nodeLevels[nodeIndex];
+  float size = lovrGraphicsGetProjectedSize(bounds, transform);
+  uint32_t level = 0;
+
+  for (uint32_t i = 0; i < model->lodCount - 1; i++) {
+    float hysteresis = model->lodHysteresis ? (current > i ? LOD_HYSTERESIS : -LOD_HYSTERESIS) : 0.f;
+    float threshold = LOD_SIZE / (float) (1 << i) * (1.f + hysteresis);
+    if (size >= threshold) {
+      break;
+    }
+    level = i + 1;
+  }
+
+  model->nodeLevels[nodeIndex] = level;
+  return level;
 }
 
-static void renderNode(Model* model, uint32_t nodeIndex, uint32_t instances) {
+static void renderNode(Model* model, uint32_t nodeIndex, mat4 transform, uint32_t instances, uint32_t* instanceStart) {
   ModelNode* node = &model->data->nodes[nodeIndex];
-  mat4 globalTransform = model->globalNodeTransforms + 16 * nodeIndex;
 
   if (node->primitiveCount > 0) {
+    float globalTransform[16];
+    mat4_multiply(mat4_init(globalTransform, transform), model->globalNodeTransforms + 16 * nodeIndex);
+    uint32_t level = (model->lods && instances == 1 && !instanceStart) ? selectLevel(model, nodeIndex, globalTransform) : 0;
     bool animated = node->skin != ~0u && model->animator;
     float pose[16 * MAX_BONES];
 
@@ -40,7 +96,7 @@ static void renderNode(Model* model, uint32_t nodeIndex, uint32_t instances) {
         mat4 inverseBindMatrix = skin->inverseBindMatrices + 16 * j;
         mat4 jointPose = pose + 16 * j;
 
-        mat4_set(jointPose, globalTransform);
+        mat4_set(jointPose, model->globalNodeTransforms + 16 * nodeIndex);
         mat4_invert(jointPose);
         mat4_multiply(jointPose, globalJointTransform);
         mat4_multiply(jointPose, inverseBindMatrix);
@@ -59,6 +115,28 @@ static void renderNode(Model* model, uint32_t nodeIndex, uint32_t instances) {
       uint32_t rangeStart, rangeCount;
       lovrMeshGetDrawRange(mesh, &rangeStart, &rangeCount);
 
+      if (level > 0 && model->lods[node->primitiveIndex + i].levelCount > 1) {
+        ModelLOD* lod = &model->lods[node->primitiveIndex + i];
+        uint32_t l = MIN(level, lod->levelCount - 1);
+        mesh = lod->mesh;
+        rangeStart = lod->ranges[l][0];
+        rangeCount = lod->ranges[l][1];
+      }
+
+      // Skinned and instanced primitives can end up outside of their bounds, so they aren't culled
+      float bounds[6];
+      bool cullable = false;
+      ModelAttribute* position = primitive->attributes[ATTR_POSITION];
+      if (!animated && instances == 1 && !instanceStart && position && position->hasMin && position->hasMax) {
+        bounds[0] = position->min[0];
+        bounds[1] = position->max[0];
+        bounds[2] = position->min[1];
+        bounds[3] = position->max[1];
+        bounds[4] = position->min[2];
+        bounds[5] = position->max[2];
+        cullable = true;
+      }
+
       lovrGraphicsBatch(&(BatchRequest) {
         .type = BATCH_MESH,
         .params.mesh = {
@@ -67,18 +145,17 @@ static void renderNode(Model* model, uint32_t nodeIndex, uint32_t instances) {
           .rangeStart = rangeStart,
           .rangeCount = rangeCount,
           .instances = instances,
-          .pose = animated ? pose : NULL
+          .pose = animated ? pose : NULL,
+          .instanceData = instanceStart != NULL,
+          .instanceStart = instanceStart ? *instanceStart : 0
         },
         .drawMode = primitive->mode,
         .transform = globalTransform,
-        .material = material
+        .material = material,
+        .bounds = cullable ? bounds : NULL
       });
     }
   }
-
-  for (uint32_t i = 0; i < node->childCount; i++) {
-    renderNode(model, node->children[i], instances);
-  }
 }
 
 Model* lovrModelInit(Model* model, ModelData* data) {
@@ -185,9 +262,37 @@ Model* lovrModelInit(Model* model, ModelData* data) {
     }
   }
 
-  model->globalNodeTransforms = malloc(16 * sizeof(float) * model->data->nodeCount);
-  for (uint32_t i = 0; i < model->data->nodeCount; i++) {
+  // Flatten the node hierarchy into a parent-first order
+  uint32_t nodeCount = data->nodeCount;
+  model->localNodeTransforms = malloc(16 * sizeof(float) * nodeCount);
+  model->globalNodeTransforms = malloc(16 * sizeof(float) * nodeCount);
+  model->nodeOrder = malloc(nodeCount * sizeof(uint32_t));
+  model->nodeParents = malloc(nodeCount * sizeof(uint32_t));
+  model->animatedNodes = calloc(nodeCount, sizeof(bool));
+  model->dirtyNodes = calloc(nodeCount, sizeof(bool));
+  lovrAssert(model->localNodeTransforms && model->globalNodeTransforms && model->nodeOrder && model->nodeParents && model->animatedNodes && model->dirtyNodes, "Out of memory");
+
+  for (uint32_t i = 0; i < nodeCount; i++) {
+    mat4_init(model->localNodeTransforms + 16 * i, data->nodes[i].transform);
     mat4_identity(model->globalNodeTransforms + 16 * i);
+    model->nodeParents[i] = ~0u;
+  }
+
+  if (data->rootNode < nodeCount) {
+    model->nodeOrder[model->nodeOrderCount++] = data->rootNode;
+    for (uint32_t i = 0; i < model->nodeOrderCount; i++) {
+      ModelNode* node = &data->nodes[model->nodeOrder[i]];
+      for (uint32_t j = 0; j < node->childCount && model->nodeOrderCount < nodeCount; j++) {
+        model->nodeParents[node->children[j]] = model->nodeOrder[i];
+        model->nodeOrder[model->nodeOrderCount++] = node->children[j];
+      }
+    }
+  }
+
+  for (uint32_t i = 0; i < data->animationCount; i++) {
+    for (uint32_t j = 0; j < data->animations[i].channelCount; j++) {
+      model->animatedNodes[data->animations[i].channels[j].nodeIndex] = true;
+    }
   }
 
   return model;
@@ -202,11 +307,208 @@ void lovrModelDestroy(void* ref) {
     lovrRelease(Mesh, model->meshes[i]);
   }
   lovrRelease(ModelData, model->data);
+  free(model->localNodeTransforms);
+  free(model->globalNodeTransforms);
+  free(model->nodeOrder);
+  free(model->nodeParents);
+  free(model->animatedNodes);
+  free(model->dirtyNodes);
+  if (model->lods) {
+    for (uint32_t i = 0; i < model->data->primitiveCount; i++) {
+      lovrRelease(Mesh, model->lods[i].mesh);
+    }
+  }
+  free(model->lods);
+  free(model->nodeBounds);
+  free(model->nodeLevels);
 }
 
+// The stored levels belong to whichever draw ran last, so hysteresis is only used while the model is
+// drawn once per frame.  A model drawn several times in the previous frame is assumed to be again.
 void lovrModelDraw(Model* model, mat4 transform, uint32_t instances) {
-  updateGlobalNodeTransform(model, model->data->rootNode, transform);
-  renderNode(model, model->data->rootNode, instances);
+  uint32_t frame = lovrGraphicsGetFrame();
+  if (model->lodFrame != frame) {
+    model->lodShared = model->lodDraws > 1;
+    model->lodFrame = frame;
+    model->lodDraws = 0;
+  }
+  model->lodHysteresis = ++model->lodDraws == 1 && !model->lodShared;
+
+  updateGlobalNodeTransforms(model);
+  for (uint32_t i = 0; i < model->nodeOrderCount; i++) {
+    renderNode(model, model->nodeOrder[i], transform, instances, NULL);
+  }
+}
+
+// The instance data is uploaded once and shared by every primitive, in chunks that fit in the stream
+void lovrModelDrawInstanced(Model* model, float* transforms, float* colors, uint32_t count) {
+  updateGlobalNodeTransforms(model);
+  for (uint32_t offset = 0; offset < count; offset += MAX_INSTANCES) {
+    uint32_t chunk = MIN(count - offset, MAX_INSTANCES);
+    uint32_t start = lovrGraphicsWriteInstances(transforms + 16 * offset, colors ? colors + 4 * offset : NULL, chunk);
+    for (uint32_t i = 0; i < model->nodeOrderCount; i++) {
+      renderNode(model, model->nodeOrder[i], (float[]) MAT4_IDENTITY, chunk, &start);
+    }
+  }
+}
+
+static uint32_t readIndex(void* indices, size_t size, uint32_t i) {
+  return size == 2 ? ((uint16_t*) indices)[i] : ((uint32_t*) indices)[i];
+}
+
+// Simplifies a primitive by vertex clustering: vertices are snapped to a grid over the primitive's
+// bounds, every triangle is remapped to the first vertex found in each of its cells, and triangles
+// that collapse are dropped.  The vertices are shared with the full detail mesh, so each level is
+// just a range of a new index buffer.  Coarser levels halve the grid resolution, and generation stops
+// early once a level no longer removes a meaningful number of triangles.
+static void simplifyPrimitive(Model* model, uint32_t index, uint32_t levels) {
+  ModelData* data = model->data;
+  ModelPrimitive* primitive = &data->primitives[index];
+  ModelAttribute* position = primitive->attributes[ATTR_POSITION];
+  ModelAttribute* indexAttribute = primitive->indices;
+  ModelLOD* lod = &model->lods[index];
+  lod->levelCount = 1;
+
+  if (primitive->mode != DRAW_TRIANGLES || !indexAttribute || !position || position->type != F32 || position->components < 3 || !position->hasMin || !position->hasMax) {
+    return;
+  }
+
+  ModelBuffer* positionBuffer = &data->buffers[position->buffer];
+  char* positions = positionBuffer->data + position->offset;
+  size_t stride = positionBuffer->stride ? positionBuffer->stride : position->components * sizeof(float);
+  void* sourceIndices = data->buffers[indexAttribute->buffer].data + indexAttribute->offset;
+  size_t indexSize = indexAttribute->type == U16 ? 2 : 4;
+  uint32_t sourceCount = indexAttribute->count - indexAttribute->count % 3;
+  uint32_t vertexCount = position->count;
+
+  uint32_t* remap = malloc(vertexCount * sizeof(uint32_t));
+  uint32_t* cells = malloc(LOD_GRID * LOD_GRID * LOD_GRID * sizeof(uint32_t));
+  uint32_t* indices = malloc((levels - 1) * sourceCount * sizeof(uint32_t));
+  lovrAssert(remap && cells && indices, "Out of memory");
+
+  uint32_t previousCount = sourceCount;
+  uint32_t total = 0;
+
+  for (uint32_t level = 1; level < levels; level++) {
+    uint32_t grid = LOD_GRID >> (level - 1);
+    float scale[3];
+    for (int k = 0; k < 3; k++) {
+      float extent = position->max[k] - position->min[k];
+      scale[k] = extent > 0.f ? grid / extent : 0.f;
+    }
+
+    memset(remap, 0xff, vertexCount * sizeof(uint32_t));
+    memset(cells, 0xff, grid * grid * grid * sizeof(uint32_t));
+    uint32_t* output = indices + total;
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < sourceCount; i += 3) {
+      uint32_t triangle[3];
+      bool valid = true;
+
+      for (uint32_t j = 0; j < 3 && valid; j++) {
+        uint32_t v = readIndex(sourceIndices, indexSize, i + j);
+        if (v >= vertexCount) {
+          valid = false;
+          break;
+        }
+
+        if (remap[v] == ~0u) {
+          float* p = (float*) (positions + v * stride);
+          uint32_t cell = 0;
+          for (int k = 2; k >= 0; k--) {
+            int c = (int) ((p[k] - position->min[k]) * scale[k]);
+            cell = cell * grid + CLAMP(c, 0, (int) grid - 1);
+          }
+
+          if (cells[cell] == ~0u) {
+            cells[cell] = v;
+          }
+
+          remap[v] = cells[cell];
+        }
+
+        triangle[j] = remap[v];
+      }
+
+      if (valid && triangle[0] != triangle[1] && triangle[1] != triangle[2] && triangle[0] != triangle[2]) {
+        memcpy(output + count, triangle, 3 * sizeof(uint32_t));
+        count += 3;
+      }
+    }
+
+    if (count == 0 || count > previousCount * 9 / 10) {
+      break;
+    }
+
+    lod->ranges[level][0] = total;
+    lod->ranges[level][1] = count;
+    lod->levelCount++;
+    previousCount = count;
+    total += count;
+  }
+
+  if (lod->levelCount > 1) {
+    if (indexSize == 2) {
+      uint16_t* shortIndices = (uint16_t*) indices;
+      for (uint32_t i = 0; i < total; i++) {
+        shortIndices[i] = (uint16_t) indices[i];
+      }
+    }
+
+    Buffer* buffer = lovrBufferCreate(total * indexSize, indices, BUFFER_INDEX, USAGE_STATIC, false);
+    Mesh* mesh = model->meshes[index];
+    lod->mesh = lovrMeshCreate(primitive->mode, NULL, 0);
+    for (uint32_t i = 0; i < mesh->attributeCount; i++) {
+      lovrMeshAttachAttribute(lod->mesh, mesh->attributeNames[i], &mesh->attributes[i]);
+    }
+    lovrMeshSetIndexBuffer(lod->mesh, buffer, total, indexSize, 0);
+    lovrRelease(Buffer, buffer);
+  }
+
+  free(remap);
+  free(cells);
+  free(indices);
+}
+
+void lovrModelGenerateLODs(Model* model, uint32_t levels) {
+  ModelData* data = model->data;
+  levels = CLAMP(levels, 1, MAX_LODS);
+  if (model->lods || levels == 1 || data->primitiveCount == 0) {
+    return;
+  }
+
+  model->lods = calloc(data->primitiveCount, sizeof(ModelLOD));
+  model->nodeBounds = malloc(6 * data->nodeCount * sizeof(float));
+  model->nodeLevels = calloc(data->nodeCount, sizeof(uint8_t));
+  lovrAssert(model->lods && model->nodeBounds && model->nodeLevels, "Out of memory");
+
+  for (uint32_t i = 0; i < data->primitiveCount; i++) {
+    simplifyPrimitive(model, i, levels);
+    model->lodCount = MAX(model->lodCount, model->lods[i].levelCount);
+  }
+
+  // Levels are selected per node, using the combined bounds of its primitives
+  for (uint32_t i = 0; i < data->nodeCount; i++) {
+    ModelNode* node = &data->nodes[i];
+    float* bounds = model->nodeBounds + 6 * i;
+    bounds[0] = bounds[2] = bounds[4] = FLT_MAX;
+    bounds[1] = bounds[3] = bounds[5] = -FLT_MAX;
+
+    for (uint32_t j = 0; j < node->primitiveCount; j++) {
+      ModelAttribute* position = data->primitives[node->primitiveIndex + j].attributes[ATTR_POSITION];
+      if (position && position->hasMin && position->hasMax) {
+        for (int k = 0; k < 3; k++) {
+          bounds[2 * k + 0] = MIN(bounds[2 * k + 0], position->min[k]);
+          bounds[2 * k + 1] = MAX(bounds[2 * k + 1], position->max[k]);
+        }
+      }
+    }
+  }
+}
+
+uint32_t lovrModelGetLODCount(Model* model) {
+  return MAX(model->lodCount, 1);
 }
 
 Animator* lovrModelGetAnimator(Model* model) {
@@ -218,6 +520,7 @@ void lovrModelSetAnimator(Model* model, Animator* animator) {
     lovrRetain(animator);
     lovrRelease(Animator, model->animator);
     model->animator = animator;
+    model->transformsValid = false;
   }
 }
 
@@ -268,15 +571,13 @@ static void applyAABB(Model* model, uint32_t nodeIndex, float aabb[6]) {
       aabb[5] = MAX(aabb[5], max[2]);
     }
   }
-
-  for (uint32_t i = 0; i < node->childCount; i++) {
-    applyAABB(model, node->children[i], aabb);
-  }
 }
 
 void lovrModelGetAABB(Model* model, float aabb[6]) {
   aabb[0] = aabb[2] = aabb[4] = FLT_MAX;
   aabb[1] = aabb[3] = aabb[5] = -FLT_MAX;
-  updateGlobalNodeTransform(model, model->data->rootNode, (float[]) MAT4_IDENTITY);
-  applyAABB(model, model->data->rootNode, aabb);
+  updateGlobalNodeTransforms(model);
+  for (uint32_t i = 0; i < model->nodeOrderCount; i++) {
+    applyAABB(model, model->nodeOrder[i], aabb);
+  }
 }
@@ -1,7 +1,10 @@
+#include <stdbool.h>
 #include <stdint.h>
 
 #pragma once
 
+#define MAX_LODS 4
+
 struct Animator;
 struct Buffer;
 struct Material;
@@ -9,6 +12,12 @@ struct Mesh;
 struct ModelData;
 struct Texture;
 
+typedef struct {
+  struct Mesh* mesh;
+  uint32_t levelCount;
+  uint32_t ranges[MAX_LODS][2];
+} ModelLOD;
+
 typedef struct {
   struct ModelData* data;
   struct Animator* animator;
@@ -17,13 +26,31 @@ typedef struct {
   struct Texture** textures;
   struct Material** materials;
   struct Material* userMaterial;
+  float* localNodeTransforms;
   float* globalNodeTransforms;
+  uint32_t* nodeOrder;
+  uint32_t* nodeParents;
+  uint32_t nodeOrderCount;
+  bool* animatedNodes;
+  bool* dirtyNodes;
+  bool transformsValid;
+  ModelLOD* lods;
+  float* nodeBounds;
+  uint8_t* nodeLevels;
+  uint32_t lodCount;
+  uint32_t lodFrame;
+  uint32_t lodDraws;
+  bool lodShared;
+  bool lodHysteresis;
 } Model;
 
 Model* lovrModelInit(Model* model, struct ModelData* data);
 #define lovrModelCreate(...) lovrModelInit(lovrAlloc(Model), __VA_ARGS__)
 void lovrModelDestroy(void* ref);
 void lovrModelDraw(Model* model, float* transform, uint32_t instances);
+void lovrModelDrawInstanced(Model* model, float* transforms, float* colors, uint32_t count);
+void lovrModelGenerateLODs(Model* model, uint32_t levels);
+uint32_t lovrModelGetLODCount(Model* model);
 struct Animator* lovrModelGetAnimator(Model* model);
 void lovrModelSetAnimator(Model* model, struct Animator* animator);
 struct Material* lovrModelGetMaterial(Model* model);
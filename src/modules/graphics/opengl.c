@@ -8,6 +8,10 @@
 #include "graphics/texture.h"
 #include "resources/shaders.h"
 #include "data/modelData.h"
+#include "core/profiler.h"
+#ifdef LOVR_ENABLE_FILESYSTEM
+#include "filesystem/filesystem.h"
+#endif
 #include "lib/vec/vec.h"
 #include <math.h>
 #include <limits.h>
@@ -20,6 +24,8 @@
 #define MAX_TEXTURES 16
 #define MAX_IMAGES 8
 #define MAX_BLOCK_BUFFERS 8
+#define MAX_TIMER_FRAMES 4
+#define MAX_TIMER_QUERIES 1024
 
 #define LOVR_SHADER_POSITION 0
 #define LOVR_SHADER_NORMAL 1
@@ -29,6 +35,20 @@
 #define LOVR_SHADER_BONES 5
 #define LOVR_SHADER_BONE_WEIGHTS 6
 #define LOVR_SHADER_DRAW_ID 7
+#define LOVR_SHADER_INSTANCE_TRANSFORM 8 // Uses 4 locations, one per column
+#define LOVR_SHADER_INSTANCE_COLOR 12 // Shaders with the noInstanceAttributes flag leave 8-12 free
+
+// KHR_parallel_shader_compile is not part of the GL loader, so its entry point is loaded by hand
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void (*PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+// Multi-draw indirect is core in GL 4.3, which is newer than the GL loader's target
+#ifndef LOVR_WEBGL
+typedef void (APIENTRYP PFNGLMULTIDRAWARRAYSINDIRECTPROC)(GLenum mode, const void* indirect, GLsizei drawcount, GLsizei stride);
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+static PFNGLMULTIDRAWARRAYSINDIRECTPROC glMultiDrawArraysIndirect;
+static PFNGLMULTIDRAWELEMENTSINDIRECTPROC glMultiDrawElementsIndirect;
+#endif
 
 typedef enum {
   BARRIER_BLOCK,
@@ -45,6 +65,16 @@ typedef struct {
   size_t size;
 } BlockBuffer;
 
+// Timestamp queries are read back MAX_TIMER_FRAMES - 1 frames after they are issued so that reading
+// them never stalls the pipeline.  Frames whose results still aren't ready at that point are dropped.
+typedef struct {
+  GLuint queries[MAX_TIMER_QUERIES][2];
+  GpuTimerType types[MAX_TIMER_QUERIES];
+  uint32_t count;
+  GLint64 gpuBase;
+  double cpuBase;
+} TimerFrame;
+
 static struct {
   Texture* defaultTexture;
   bool alphaToCoverage;
@@ -77,6 +107,13 @@ static struct {
   GpuFeatures features;
   GpuLimits limits;
   GpuStats stats;
+  bool timing;
+  uint32_t timerFrame;
+  uint32_t passTimer;
+  Canvas* passCanvas;
+  TimerFrame timerFrames[MAX_TIMER_FRAMES];
+  bool programCache;
+  bool parallelCompile;
 } state;
 
 // Helper functions
@@ -221,6 +258,9 @@ static GLenum convertBufferType(BufferType type) {
     case BUFFER_UNIFORM: return GL_UNIFORM_BUFFER;
     case BUFFER_SHADER_STORAGE: return GL_SHADER_STORAGE_BUFFER;
     case BUFFER_GENERIC: return GL_COPY_WRITE_BUFFER;
+#ifndef LOVR_WEBGL
+    case BUFFER_DRAW_INDIRECT: return GL_DRAW_INDIRECT_BUFFER;
+#endif
     default: lovrThrow("Unreachable");
   }
 }
@@ -363,7 +403,7 @@ static void lovrGpuSync(uint8_t flags) {
     vec_clear(&state.incoherents[i]);
 
     switch (i) {
-      case BARRIER_BLOCK: bits |= GL_SHADER_STORAGE_BARRIER_BIT; break;
+      case BARRIER_BLOCK: bits |= GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT; break;
       case BARRIER_UNIFORM_IMAGE: bits |= GL_SHADER_IMAGE_ACCESS_BARRIER_BIT; break;
       case BARRIER_UNIFORM_TEXTURE: bits |= GL_TEXTURE_FETCH_BARRIER_BIT; break;
       case BARRIER_TEXTURE: bits |= GL_TEXTURE_UPDATE_BARRIER_BIT; break;
@@ -489,7 +529,9 @@ static void lovrGpuBindImage(Image* image, int slot) {
 }
 #endif
 
-static void lovrGpuBindMesh(Mesh* mesh, Shader* shader, int baseDivisor) {
+// Instance data lives in the renderer's stream buffer and is bound to the reserved instance locations
+// here, on top of the Mesh's own attributes, so the Mesh itself is never modified.
+static void lovrGpuBindMesh(Mesh* mesh, Shader* shader, int baseDivisor, Buffer* instanceBuffer, size_t instanceOffset) {
   lovrGpuBindVertexArray(mesh);
 
   if (mesh->indexBuffer && mesh->indexCount > 0) {
@@ -535,6 +577,26 @@ static void lovrGpuBindMesh(Mesh* mesh, Shader* shader, int baseDivisor) {
     }
   }
 
+  if (instanceBuffer && lovrShaderGetAttributeLocation(shader, "lovrInstanceTransform0") >= 0) {
+    lovrBufferUnmap(instanceBuffer);
+    lovrGpuBindBuffer(BUFFER_VERTEX, instanceBuffer->id);
+    for (uint32_t i = 0; i < 5; i++) {
+      uint32_t location = LOVR_SHADER_INSTANCE_TRANSFORM + i;
+      GLvoid* offset = (GLvoid*) (intptr_t) (instanceOffset + 4 * sizeof(float) * i);
+      enabledLocations |= (1 << location);
+
+      uint16_t divisor = baseDivisor;
+      if (mesh->divisors[location] != divisor) {
+        glVertexAttribDivisor(location, divisor);
+        mesh->divisors[location] = divisor;
+      }
+
+      // Marks the location so a Mesh attribute bound there later respecifies its pointer
+      mesh->locations[location] = 0xfe;
+      glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, INSTANCE_STRIDE, offset);
+    }
+  }
+
   uint16_t diff = enabledLocations ^ mesh->enabledLocations;
   if (diff != 0) {
     for (uint32_t i = 0; i < MAX_ATTRIBUTES; i++) {
@@ -576,7 +638,7 @@ static void lovrGpuBindCanvas(Canvas* canvas, bool willDraw) {
 #endif
 
   // Use the read framebuffer as a binding point to bind resolve textures
-  if (canvas->flags.msaa) {
+  if (canvas->flags.msaa && !canvas->flags.multiview) {
     glBindFramebuffer(GL_READ_FRAMEBUFFER, canvas->resolveBuffer);
   }
 
@@ -588,6 +650,17 @@ static void lovrGpuBindCanvas(Canvas* canvas, bool willDraw) {
     uint32_t slice = attachment->slice;
     uint32_t level = attachment->level;
 
+#ifndef LOVR_WEBGL
+    if (canvas->flags.multiview) {
+      if (canvas->flags.msaa) {
+        glFramebufferTextureMultisampleMultiviewOVR(GL_FRAMEBUFFER, buffer, texture->id, level, canvas->flags.msaa, slice, 2);
+      } else {
+        glFramebufferTextureMultiviewOVR(GL_FRAMEBUFFER, buffer, texture->id, level, slice, 2);
+      }
+      continue;
+    }
+#endif
+
     if (canvas->flags.msaa) {
       glFramebufferRenderbuffer(GL_FRAMEBUFFER, buffer, GL_RENDERBUFFER, texture->msaaId);
     }
@@ -772,6 +845,7 @@ static void lovrGpuBindShader(Shader* shader) {
   Uniform* uniform;
   int i;
 
+  lovrShaderWait(shader);
   lovrGpuUseProgram(shader->program);
 
   // Figure out if we need to wait for pending writes on resources to complete
@@ -912,6 +986,126 @@ static void lovrGpuSetViewports(float* viewport, uint32_t count) {
 #endif
 }
 
+#ifdef LOVR_GLES
+#undef glQueryCounter
+#undef glGetQueryObjectui64v
+#define glQueryCounter glQueryCounterEXT
+#define glGetQueryObjectui64v glGetQueryObjectui64vEXT
+#endif
+
+static const char* timerNames[] = {
+  [TIMER_DRAW] = "draw",
+  [TIMER_COMPUTE] = "compute",
+  [TIMER_RESOLVE] = "resolve",
+  [TIMER_PASS] = "pass"
+};
+
+static uint32_t lovrGpuBeginTimer(GpuTimerType type) {
+#ifndef LOVR_WEBGL
+  TimerFrame* frame = &state.timerFrames[state.timerFrame];
+  if (state.timing && frame->count < MAX_TIMER_QUERIES) {
+    uint32_t index = frame->count++;
+    frame->types[index] = type;
+    glQueryCounter(frame->queries[index][0], GL_TIMESTAMP);
+    return index;
+  }
+#endif
+  return ~0u;
+}
+
+static void lovrGpuEndTimer(uint32_t index) {
+#ifndef LOVR_WEBGL
+  if (index != ~0u) {
+    glQueryCounter(state.timerFrames[state.timerFrame].queries[index][1], GL_TIMESTAMP);
+  }
+#endif
+}
+
+// Draws and clears are grouped into passes by the Canvas they render to
+static void lovrGpuTimePass(Canvas* canvas) {
+  if (state.passTimer != ~0u && state.passCanvas == canvas) {
+    return;
+  }
+
+  lovrGpuEndTimer(state.passTimer);
+  state.passTimer = lovrGpuBeginTimer(TIMER_PASS);
+  state.passCanvas = canvas;
+}
+
+static void lovrGpuReadTimers(TimerFrame* frame) {
+#ifndef LOVR_WEBGL
+  if (frame->count == 0) {
+    return;
+  }
+
+  GLuint available;
+  glGetQueryObjectuiv(frame->queries[frame->count - 1][1], GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available) {
+    return;
+  }
+
+#ifdef LOVR_GLES
+  GLint disjoint;
+  glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+  if (disjoint) {
+    return;
+  }
+#endif
+
+  GpuTimings* timings = &state.stats.timings;
+  memset(timings, 0, sizeof(*timings));
+  GLuint64 first = ~(GLuint64) 0;
+  GLuint64 last = 0;
+
+  for (uint32_t i = 0; i < frame->count; i++) {
+    GLuint64 start, end;
+    glGetQueryObjectui64v(frame->queries[i][0], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(frame->queries[i][1], GL_QUERY_RESULT, &end);
+    double duration = (end - start) / 1e9;
+    GpuTimerType type = frame->types[i];
+    timings->times[type] += duration;
+    first = MIN(first, start);
+    last = MAX(last, end);
+
+    if (type == TIMER_PASS && timings->passCount < MAX_TIMER_PASSES) {
+      timings->passes[timings->passCount++] = duration;
+    }
+
+    LOVR_ZONE_RECORD("GPU", timerNames[type], frame->cpuBase + ((GLint64) start - frame->gpuBase) / 1e9, duration);
+  }
+
+  timings->total = (last - first) / 1e9;
+  timings->valid = true;
+#endif
+}
+
+bool lovrGpuIsTimingEnabled() {
+  return state.timing;
+}
+
+void lovrGpuSetTimingEnabled(bool enable) {
+  if (state.timing == enable || (enable && !state.features.timers)) {
+    return;
+  }
+
+#ifndef LOVR_WEBGL
+  for (uint32_t i = 0; i < MAX_TIMER_FRAMES; i++) {
+    TimerFrame* frame = &state.timerFrames[i];
+    if (enable) {
+      glGenQueries(2 * MAX_TIMER_QUERIES, &frame->queries[0][0]);
+    } else {
+      glDeleteQueries(2 * MAX_TIMER_QUERIES, &frame->queries[0][0]);
+    }
+    frame->count = 0;
+  }
+#endif
+
+  state.timing = enable;
+  state.passTimer = ~0u;
+  state.passCanvas = NULL;
+  memset(&state.stats.timings, 0, sizeof(state.stats.timings));
+}
+
 // GPU
 
 void lovrGpuInit(getProcAddressProc getProcAddress) {
@@ -924,6 +1118,11 @@ void lovrGpuInit(getProcAddressProc getProcAddress) {
 #ifndef LOVR_WEBGL
   state.features.compute = GLAD_GL_ARB_compute_shader;
   state.features.singlepass = GLAD_GL_ARB_viewport_array && GLAD_GL_AMD_vertex_shader_viewport_index && GLAD_GL_ARB_fragment_layer_viewport;
+#ifdef LOVR_GLES
+  state.features.timers = GLAD_GL_EXT_disjoint_timer_query;
+#else
+  state.features.timers = GLAD_GL_VERSION_3_3;
+#endif
   glEnable(GL_LINE_SMOOTH);
   glEnable(GL_PROGRAM_POINT_SIZE);
   glEnable(GL_FRAMEBUFFER_SRGB);
@@ -932,6 +1131,74 @@ void lovrGpuInit(getProcAddressProc getProcAddress) {
   glGetFloatv(GL_ALIASED_POINT_SIZE_RANGE, state.limits.pointSizes);
 #endif
 
+  // Program binaries are core in GL 4.1 and GLES 3, but the GL loader only targets 3.3
+#if defined(LOVR_GL) && defined(LOVR_ENABLE_FILESYSTEM)
+  if (!glGetProgramBinary) {
+    glad_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC) getProcAddress("glGetProgramBinary");
+    glad_glProgramBinary = (PFNGLPROGRAMBINARYPROC) getProcAddress("glProgramBinary");
+    glad_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC) getProcAddress("glProgramParameteri");
+  }
+#endif
+
+#if !defined(LOVR_WEBGL) && defined(LOVR_ENABLE_FILESYSTEM)
+  GLint binaryFormatCount = 0;
+  if (glGetProgramBinary && glProgramBinary && glProgramParameteri) {
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormatCount);
+  }
+  state.programCache = binaryFormatCount > 0;
+#endif
+
+#ifndef LOVR_WEBGL
+#ifdef LOVR_GL
+  GLint major = 0, minor = 0;
+  bool drawIndirect = false, multiDrawIndirect = false, baseInstance = false;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+#endif
+
+  GLint extensionCount = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+  for (GLint i = 0; i < extensionCount; i++) {
+    const char* extension = (const char*) glGetStringi(GL_EXTENSIONS, i);
+    if (!extension) {
+      continue;
+    } else if (!strcmp(extension, "GL_KHR_parallel_shader_compile")) {
+      PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC) getProcAddress("glMaxShaderCompilerThreadsKHR");
+      if (glMaxShaderCompilerThreadsKHR) {
+        glMaxShaderCompilerThreadsKHR(0xffffffff);
+        state.parallelCompile = true;
+      }
+#ifdef LOVR_GL
+    } else if (!strcmp(extension, "GL_ARB_draw_indirect")) {
+      drawIndirect = true;
+    } else if (!strcmp(extension, "GL_ARB_multi_draw_indirect")) {
+      multiDrawIndirect = true;
+    } else if (!strcmp(extension, "GL_ARB_base_instance")) {
+      baseInstance = true;
+#endif
+    }
+  }
+
+  state.features.multiview = GLAD_GL_OVR_multiview && GLAD_GL_OVR_multiview2 && glFramebufferTextureMultiviewOVR;
+
+  // Batched multi-draws select the draw ID with the base instance, which GLES doesn't have
+#ifdef LOVR_GLES
+  state.features.indirect = GLAD_GL_ES_VERSION_3_1 && glDrawElementsIndirect && glDrawArraysIndirect;
+#else
+  if (major >= 4 || drawIndirect) {
+    glad_glDrawArraysIndirect = (PFNGLDRAWARRAYSINDIRECTPROC) getProcAddress("glDrawArraysIndirect");
+    glad_glDrawElementsIndirect = (PFNGLDRAWELEMENTSINDIRECTPROC) getProcAddress("glDrawElementsIndirect");
+    state.features.indirect = glDrawElementsIndirect && glDrawArraysIndirect;
+  }
+
+  if (state.features.indirect && ((major == 4 && minor >= 3) || major > 4 || (multiDrawIndirect && baseInstance))) {
+    glMultiDrawArraysIndirect = (PFNGLMULTIDRAWARRAYSINDIRECTPROC) getProcAddress("glMultiDrawArraysIndirect");
+    glMultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC) getProcAddress("glMultiDrawElementsIndirect");
+    state.features.multiDraw = glMultiDrawArraysIndirect && glMultiDrawElementsIndirect;
+  }
+#endif
+#endif
+
   glGetIntegerv(GL_MAX_TEXTURE_SIZE, &state.limits.textureSize);
   glGetIntegerv(GL_MAX_SAMPLES, &state.limits.textureMSAA);
   glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &state.limits.blockSize);
@@ -987,9 +1254,12 @@ void lovrGpuInit(getProcAddressProc getProcAddress) {
   for (int i = 0; i < MAX_BARRIERS; i++) {
     vec_init(&state.incoherents[i]);
   }
+
+  state.passTimer = ~0u;
 }
 
 void lovrGpuDestroy() {
+  lovrGpuSetTimingEnabled(false);
   lovrRelease(Texture, state.defaultTexture);
   for (int i = 0; i < MAX_TEXTURES; i++) {
     lovrRelease(Texture, state.textures[i]);
@@ -1004,6 +1274,7 @@ void lovrGpuDestroy() {
 }
 
 void lovrGpuClear(Canvas* canvas, Color* color, float* depth, int* stencil) {
+  lovrGpuTimePass(canvas);
   lovrGpuBindCanvas(canvas, true);
 
   if (color) {
@@ -1035,7 +1306,9 @@ void lovrGpuCompute(Shader* shader, int x, int y, int z) {
   lovrAssert(shader->type == SHADER_COMPUTE, "Attempt to use a non-compute shader for a compute operation");
   lovrGraphicsFlush();
   lovrGpuBindShader(shader);
+  uint32_t timer = lovrGpuBeginTimer(TIMER_COMPUTE);
   glDispatchCompute(x, y, z);
+  lovrGpuEndTimer(timer);
 #endif
 }
 
@@ -1065,20 +1338,31 @@ void lovrGpuDiscard(Canvas* canvas, bool color, bool depth, bool stencil) {
 #endif
 }
 
+// Multiview canvases render every view with a single draw, each view goes to its own layer
 void lovrGpuDraw(DrawCommand* draw) {
+  bool multiview = draw->canvas && draw->canvas->flags.multiview;
   uint32_t viewCount = 1 + draw->stereo;
-  uint32_t drawCount = state.features.singlepass ? 1 : viewCount;
-  uint32_t viewsPerDraw = state.features.singlepass ? viewCount : 1;
+  uint32_t drawCount = state.features.singlepass || multiview ? 1 : viewCount;
+  uint32_t viewsPerDraw = state.features.singlepass && !multiview ? viewCount : 1;
   uint32_t instances = MAX(draw->instances, 1) * viewsPerDraw;
 
-  float w = draw->width / (float) viewCount;
+  float w = multiview ? draw->width : draw->width / (float) viewCount;
   float h = draw->height;
   float viewports[2][4] = { { 0, 0, w, h }, { w, 0, w, h } };
   lovrShaderSetInts(draw->shader, "lovrViewportCount", &(int) { viewCount }, 0, 1);
 
+  lovrGpuTimePass(draw->canvas);
   lovrGpuBindCanvas(draw->canvas, true);
   lovrGpuBindPipeline(&draw->pipeline);
-  lovrGpuBindMesh(draw->mesh, draw->shader, viewsPerDraw);
+  lovrGpuBindMesh(draw->mesh, draw->shader, viewsPerDraw, draw->instanceBuffer, draw->instanceOffset);
+
+#ifndef LOVR_WEBGL
+  if (draw->indirectBuffer && (draw->indirectBuffer->incoherent >> BARRIER_BLOCK) & 1) {
+    lovrGpuSync(1 << BARRIER_BLOCK);
+  }
+#endif
+
+  uint32_t timer = lovrGpuBeginTimer(TIMER_DRAW);
 
   for (uint32_t i = 0; i < drawCount; i++) {
     lovrGpuSetViewports(&viewports[i][0], viewsPerDraw);
@@ -1087,7 +1371,30 @@ void lovrGpuDraw(DrawCommand* draw) {
 
     Mesh* mesh = draw->mesh;
     GLenum mode = convertDrawMode(draw->drawMode);
-    if (mesh->indexCount > 0) {
+    if (draw->indirectBuffer) {
+#ifndef LOVR_WEBGL
+      GLenum indexType = mesh->indexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+      GLsizei count = draw->indirectCount;
+      GLsizei stride = draw->indirectStride;
+      lovrGpuBindBuffer(BUFFER_DRAW_INDIRECT, draw->indirectBuffer->id);
+      if (count > 1 && state.features.multiDraw) {
+        if (mesh->indexCount > 0) {
+          glMultiDrawElementsIndirect(mode, indexType, (GLvoid*) draw->indirectOffset, count, stride);
+        } else {
+          glMultiDrawArraysIndirect(mode, (GLvoid*) draw->indirectOffset, count, stride);
+        }
+      } else {
+        for (GLsizei j = 0; j < count; j++) {
+          GLvoid* offset = (GLvoid*) (draw->indirectOffset + j * stride);
+          if (mesh->indexCount > 0) {
+            glDrawElementsIndirect(mode, indexType, offset);
+          } else {
+            glDrawArraysIndirect(mode, offset);
+          }
+        }
+      }
+#endif
+    } else if (mesh->indexCount > 0) {
       GLenum indexType = mesh->indexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
       GLvoid* offset = (GLvoid*) (mesh->indexOffset + draw->rangeStart * mesh->indexSize);
       if (instances > 1) {
@@ -1105,10 +1412,28 @@ void lovrGpuDraw(DrawCommand* draw) {
 
     state.stats.drawCalls++;
   }
+
+  lovrGpuEndTimer(timer);
 }
 
 void lovrGpuPresent() {
-  memset(&state.stats, 0, sizeof(state.stats));
+  state.stats.shaderSwitches = 0;
+  state.stats.drawCalls = 0;
+
+  if (state.timing) {
+    lovrGpuEndTimer(state.passTimer);
+    state.passTimer = ~0u;
+    state.passCanvas = NULL;
+    state.timerFrame = (state.timerFrame + 1) % MAX_TIMER_FRAMES;
+    TimerFrame* frame = &state.timerFrames[state.timerFrame];
+    lovrGpuReadTimers(frame);
+    frame->count = 0;
+    frame->cpuBase = lovrPlatformGetTime();
+#ifndef LOVR_WEBGL
+    glGetInteger64v(GL_TIMESTAMP, &frame->gpuBase);
+#endif
+  }
+
 #ifdef __APPLE__
   // For some reason instancing doesn't work on macOS unless you reset the shader every frame
   lovrGpuUseProgram(0);
@@ -1431,13 +1756,30 @@ Canvas* lovrCanvasInit(Canvas* canvas, uint32_t width, uint32_t height, CanvasFl
   canvas->height = height;
   canvas->flags = flags;
 
+  if (flags.multiview) {
+    lovrAssert(state.features.multiview, "Multiview is not supported on this system");
+    lovrAssert(flags.stereo, "Multiview Canvases must be stereo");
+    lovrAssert(!flags.msaa || GLAD_GL_OVR_multiview_multisampled_render_to_texture, "Multiview Canvases do not support MSAA on this system");
+  }
+
   glGenFramebuffers(1, &canvas->framebuffer);
   lovrGpuBindFramebuffer(canvas->framebuffer);
 
   if (flags.depth.enabled) {
     lovrAssert(isTextureFormatDepth(flags.depth.format), "Canvas depth buffer can't use a color TextureFormat");
     GLenum attachment = flags.depth.format == FORMAT_D24S8 ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
-    if (flags.depth.readable) {
+    if (flags.multiview) {
+#ifndef LOVR_WEBGL
+      // Renderbuffers can't have layers, so multiview depth is always an array texture
+      canvas->depth.texture = lovrTextureCreate(TEXTURE_ARRAY, NULL, 0, false, false, 0);
+      lovrTextureAllocate(canvas->depth.texture, width, height, 2, flags.depth.format);
+      if (flags.msaa) {
+        glFramebufferTextureMultisampleMultiviewOVR(GL_FRAMEBUFFER, attachment, canvas->depth.texture->id, 0, flags.msaa, 0, 2);
+      } else {
+        glFramebufferTextureMultiviewOVR(GL_FRAMEBUFFER, attachment, canvas->depth.texture->id, 0, 0, 2);
+      }
+#endif
+    } else if (flags.depth.readable) {
       canvas->depth.texture = lovrTextureCreate(TEXTURE_2D, NULL, 0, false, flags.mipmaps, flags.msaa);
       lovrTextureAllocate(canvas->depth.texture, width, height, 1, flags.depth.format);
       glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, canvas->depth.texture->id, 0);
@@ -1450,7 +1792,7 @@ Canvas* lovrCanvasInit(Canvas* canvas, uint32_t width, uint32_t height, CanvasFl
     }
   }
 
-  if (flags.msaa) {
+  if (flags.msaa && !flags.multiview) {
     glGenFramebuffers(1, &canvas->resolveBuffer);
   }
 
@@ -1489,8 +1831,9 @@ void lovrCanvasResolve(Canvas* canvas) {
   }
 
   lovrGraphicsFlushCanvas(canvas);
+  uint32_t timer = lovrGpuBeginTimer(TIMER_RESOLVE);
 
-  if (canvas->flags.msaa) {
+  if (canvas->flags.msaa && !canvas->flags.multiview) {
     uint32_t w = canvas->width;
     uint32_t h = canvas->height;
     glBindFramebuffer(GL_READ_FRAMEBUFFER, canvas->framebuffer);
@@ -1522,6 +1865,7 @@ void lovrCanvasResolve(Canvas* canvas) {
     }
   }
 
+  lovrGpuEndTimer(timer);
   canvas->needsResolve = false;
 }
 
@@ -1632,11 +1976,14 @@ void lovrBufferUnmap(Buffer* buffer) {
 
 // Shader
 
-static GLuint compileShader(GLenum type, const char** sources, int count) {
+static GLuint startShader(GLenum type, const char** sources, int count) {
   GLuint shader = glCreateShader(type);
   glShaderSource(shader, count, sources, NULL);
   glCompileShader(shader);
+  return shader;
+}
 
+static void checkShader(GLuint shader, GLenum type) {
   int isShaderCompiled;
   glGetShaderiv(shader, GL_COMPILE_STATUS, &isShaderCompiled);
   if (!isShaderCompiled) {
@@ -1654,13 +2001,15 @@ static GLuint compileShader(GLenum type, const char** sources, int count) {
     }
     lovrThrow("Could not compile %s:\n%s", name, log);
   }
+}
 
+static GLuint compileShader(GLenum type, const char** sources, int count) {
+  GLuint shader = startShader(type, sources, count);
+  checkShader(shader, type);
   return shader;
 }
 
-static GLuint linkProgram(GLuint program) {
-  glLinkProgram(program);
-
+static void checkProgram(GLuint program) {
   int isLinked;
   glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
   if (!isLinked) {
@@ -1671,10 +2020,125 @@ static GLuint linkProgram(GLuint program) {
     glGetProgramInfoLog(program, logLength, &logLength, log);
     lovrThrow("Could not link shader:\n%s", log);
   }
+}
 
+static GLuint linkProgram(GLuint program) {
+  glLinkProgram(program);
+  checkProgram(program);
   return program;
 }
 
+// Attaches both stages and starts linking without waiting for the result, see lovrShaderWait
+static void startGraphicsProgram(GLuint program, GLuint vertexShader, GLuint fragmentShader) {
+  glAttachShader(program, vertexShader);
+  glAttachShader(program, fragmentShader);
+  glBindAttribLocation(program, LOVR_SHADER_POSITION, "lovrPosition");
+  glBindAttribLocation(program, LOVR_SHADER_NORMAL, "lovrNormal");
+  glBindAttribLocation(program, LOVR_SHADER_TEX_COORD, "lovrTexCoord");
+  glBindAttribLocation(program, LOVR_SHADER_VERTEX_COLOR, "lovrVertexColor");
+  glBindAttribLocation(program, LOVR_SHADER_TANGENT, "lovrTangent");
+  glBindAttribLocation(program, LOVR_SHADER_BONES, "lovrBones");
+  glBindAttribLocation(program, LOVR_SHADER_BONE_WEIGHTS, "lovrBoneWeights");
+  glBindAttribLocation(program, LOVR_SHADER_DRAW_ID, "lovrDrawID");
+  glBindAttribLocation(program, LOVR_SHADER_INSTANCE_TRANSFORM + 0, "lovrInstanceTransform0");
+  glBindAttribLocation(program, LOVR_SHADER_INSTANCE_TRANSFORM + 1, "lovrInstanceTransform1");
+  glBindAttribLocation(program, LOVR_SHADER_INSTANCE_TRANSFORM + 2, "lovrInstanceTransform2");
+  glBindAttribLocation(program, LOVR_SHADER_INSTANCE_TRANSFORM + 3, "lovrInstanceTransform3");
+  glBindAttribLocation(program, LOVR_SHADER_INSTANCE_COLOR, "lovrInstanceColor");
+#ifndef LOVR_WEBGL
+  if (state.programCache) {
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+#endif
+  glLinkProgram(program);
+}
+
+// Program binary cache.  Linked programs are saved to the save directory, keyed by a hash of their
+// full source and the driver, so later runs can skip compiling and linking.  If the driver rejects a
+// binary (e.g. after an update) the program is compiled normally and the cache entry is replaced.
+
+#define PROGRAM_CACHE_MAGIC 0x5043564c // LVCP
+
+static uint64_t hashProgramSources(uint64_t hash, const char** sources, int count) {
+  for (int i = 0; i < count; i++) {
+    for (const char* c = sources[i]; *c; c++) {
+      hash = (hash ^ (uint8_t) *c) * 1099511628211ull;
+    }
+    hash = (hash ^ 0xff) * 1099511628211ull;
+  }
+  return hash;
+}
+
+static void getProgramCachePath(uint64_t hash, char* path, size_t size) {
+  snprintf(path, size, "shadercache/%08x%08x.bin", (uint32_t) (hash >> 32), (uint32_t) hash);
+}
+
+static GLuint loadCachedProgram(uint64_t hash) {
+#if !defined(LOVR_WEBGL) && defined(LOVR_ENABLE_FILESYSTEM)
+  if (!state.programCache) {
+    return 0;
+  }
+
+  char path[64];
+  getProgramCachePath(hash, path, sizeof(path));
+  if (!lovrFilesystemIsFile(path)) {
+    return 0;
+  }
+
+  size_t size;
+  uint32_t* data = lovrFilesystemRead(path, -1, &size);
+  if (!data || size <= 2 * sizeof(uint32_t) || data[0] != PROGRAM_CACHE_MAGIC) {
+    free(data);
+    return 0;
+  }
+
+  GLuint program = glCreateProgram();
+  glProgramBinary(program, data[1], data + 2, (GLsizei) (size - 2 * sizeof(uint32_t)));
+  free(data);
+
+  GLint linked;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  if (!linked) {
+    glDeleteProgram(program);
+    return 0;
+  }
+
+  return program;
+#else
+  return 0;
+#endif
+}
+
+static void saveCachedProgram(GLuint program, uint64_t hash) {
+#if !defined(LOVR_WEBGL) && defined(LOVR_ENABLE_FILESYSTEM)
+  if (!state.programCache) {
+    return;
+  }
+
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+
+  uint32_t* data = malloc(2 * sizeof(uint32_t) + length);
+  if (!data) {
+    return;
+  }
+
+  GLenum format;
+  glGetProgramBinary(program, length, &length, &format, data + 2);
+  data[0] = PROGRAM_CACHE_MAGIC;
+  data[1] = format;
+
+  char path[64];
+  getProgramCachePath(hash, path, sizeof(path));
+  lovrFilesystemCreateDirectory("shadercache");
+  lovrFilesystemWrite(path, (const char*) data, 2 * sizeof(uint32_t) + length, false);
+  free(data);
+#endif
+}
+
 static void lovrShaderSetupUniforms(Shader* shader) {
   uint32_t program = shader->program;
   lovrGpuUseProgram(program); // TODO necessary?
@@ -1904,56 +2368,128 @@ static char* lovrShaderGetFlagCode(ShaderFlag* flags, uint32_t flagCount) {
   return code;
 }
 
-Shader* lovrShaderInitGraphics(Shader* shader, const char* vertexSource, const char* fragmentSource, ShaderFlag* flags, uint32_t flagCount) {
+// The sources are kept so the shader can be compiled again with or without multiview later
+static Shader* initGraphicsProgram(Shader* shader, const char* vertexSource, const char* fragmentSource, const char* flagSource, bool multiview, bool async) {
 #if defined(LOVR_WEBGL) || defined(LOVR_GLES)
-  const char* vertexHeader = "#version 300 es\nprecision mediump float;\nprecision mediump int;\n";
+  const char* vertexHeader = "#version 300 es\n";
   const char* fragmentHeader = vertexHeader;
+  const char* precision = "precision mediump float;\nprecision mediump int;\n";
 #else
   const char* vertexHeader = state.features.compute ? "#version 430\n" : "#version 150\n";
   const char* fragmentHeader = "#version 150\n";
+  const char* precision = "";
 #endif
 
-  const char* vertexSinglepass = state.features.singlepass ?
-    "#extension GL_AMD_vertex_shader_viewport_index : require\n" "#define SINGLEPASS 1\n" :
-    "#define SINGLEPASS 0\n";
+  const char* vertexSinglepass = multiview ?
+    "#extension GL_OVR_multiview2 : require\n" "#define SINGLEPASS 0\n" "#define MULTIVIEW 1\n" "layout(num_views = 2) in;\n" :
+    state.features.singlepass ?
+    "#extension GL_AMD_vertex_shader_viewport_index : require\n" "#define SINGLEPASS 1\n" "#define MULTIVIEW 0\n" :
+    "#define SINGLEPASS 0\n" "#define MULTIVIEW 0\n";
+
+  const char* fragmentSinglepass = multiview ?
+    "#define SINGLEPASS 0\n" "#define MULTIVIEW 1\n" :
+    state.features.singlepass ?
+    "#extension GL_ARB_fragment_layer_viewport : require\n" "#define SINGLEPASS 1\n" "#define MULTIVIEW 0\n" :
+    "#define SINGLEPASS 0\n" "#define MULTIVIEW 0\n";
+
+  shader->sources[0] = vertexSource ? strdup(vertexSource) : NULL;
+  shader->sources[1] = fragmentSource ? strdup(fragmentSource) : NULL;
+  shader->sources[2] = flagSource ? strdup(flagSource) : NULL;
+  vertexSource = vertexSource == NULL ? lovrDefaultVertexShader : vertexSource;
+  fragmentSource = fragmentSource == NULL ? lovrDefaultFragmentShader : fragmentSource;
+  // Extensions have to come before the precision statements in GLSL ES
+  const char* vertexSources[] = { vertexHeader, vertexSinglepass, precision, flagSource ? flagSource : "", lovrShaderVertexPrefix, vertexSource, lovrShaderVertexSuffix };
+  const char* fragmentSources[] = { fragmentHeader, fragmentSinglepass, precision, flagSource ? flagSource : "", lovrShaderFragmentPrefix, fragmentSource, lovrShaderFragmentSuffix };
+  int vertexSourceCount = sizeof(vertexSources) / sizeof(vertexSources[0]);
+  int fragmentSourceCount = sizeof(fragmentSources) / sizeof(fragmentSources[0]);
 
-  const char* fragmentSinglepass = state.features.singlepass ?
-    "#extension GL_ARB_fragment_layer_viewport : require\n" "#define SINGLEPASS 1\n" :
-    "#define SINGLEPASS 0\n";
+  uint64_t hash = 14695981039346656037ull;
+  if (state.programCache) {
+    const char* driver[] = { (const char*) glGetString(GL_VENDOR), (const char*) glGetString(GL_RENDERER), (const char*) glGetString(GL_VERSION) };
+    hash = hashProgramSources(hash, driver, 3);
+    hash = hashProgramSources(hash, vertexSources, vertexSourceCount);
+    hash = hashProgramSources(hash, fragmentSources, fragmentSourceCount);
+  }
 
-  char* flagSource = lovrShaderGetFlagCode(flags, flagCount);
+  uint32_t program = loadCachedProgram(hash);
 
-  // Vertex
-  vertexSource = vertexSource == NULL ? lovrDefaultVertexShader : vertexSource;
-  const char* vertexSources[] = { vertexHeader, vertexSinglepass, flagSource ? flagSource : "", lovrShaderVertexPrefix, vertexSource, lovrShaderVertexSuffix };
-  GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSources, sizeof(vertexSources) / sizeof(vertexSources[0]));
+  if (!program) {
+    shader->stages[0] = startShader(GL_VERTEX_SHADER, vertexSources, vertexSourceCount);
+    shader->stages[1] = startShader(GL_FRAGMENT_SHADER, fragmentSources, fragmentSourceCount);
+    program = glCreateProgram();
+    startGraphicsProgram(program, shader->stages[0], shader->stages[1]);
+  }
 
-  // Fragment
-  fragmentSource = fragmentSource == NULL ? lovrDefaultFragmentShader : fragmentSource;
-  const char* fragmentSources[] = { fragmentHeader, fragmentSinglepass, flagSource ? flagSource : "", lovrShaderFragmentPrefix, fragmentSource, lovrShaderFragmentSuffix };
-  GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSources, sizeof(fragmentSources) / sizeof(fragmentSources[0]));
+  shader->program = program;
+  shader->type = SHADER_GRAPHICS;
+  shader->multiview = multiview;
+  shader->cacheHash = hash;
+  shader->pending = true;
+
+  if (!async) {
+    lovrShaderWait(shader);
+  }
+
+  return shader;
+}
 
+// Multiview is dropped on systems that don't support it, a regular variant is used there instead
+Shader* lovrShaderInitGraphics(Shader* shader, const char* vertexSource, const char* fragmentSource, ShaderFlag* flags, uint32_t flagCount, bool multiview, bool async) {
+  char* flagSource = lovrShaderGetFlagCode(flags, flagCount);
+  initGraphicsProgram(shader, vertexSource, fragmentSource, flagSource, multiview && state.features.multiview, async);
   free(flagSource);
+  return shader;
+}
 
-  // Link
-  uint32_t program = glCreateProgram();
-  glAttachShader(program, vertexShader);
-  glAttachShader(program, fragmentShader);
-  glBindAttribLocation(program, LOVR_SHADER_POSITION, "lovrPosition");
-  glBindAttribLocation(program, LOVR_SHADER_NORMAL, "lovrNormal");
-  glBindAttribLocation(program, LOVR_SHADER_TEX_COORD, "lovrTexCoord");
-  glBindAttribLocation(program, LOVR_SHADER_VERTEX_COLOR, "lovrVertexColor");
-  glBindAttribLocation(program, LOVR_SHADER_TANGENT, "lovrTangent");
-  glBindAttribLocation(program, LOVR_SHADER_BONES, "lovrBones");
-  glBindAttribLocation(program, LOVR_SHADER_BONE_WEIGHTS, "lovrBoneWeights");
-  glBindAttribLocation(program, LOVR_SHADER_DRAW_ID, "lovrDrawID");
-  linkProgram(program);
-  glDetachShader(program, vertexShader);
-  glDeleteShader(vertexShader);
-  glDetachShader(program, fragmentShader);
-  glDeleteShader(fragmentShader);
-  shader->program = program;
-  shader->type = SHADER_GRAPHICS;
+Shader* lovrShaderInitVariant(Shader* variant, Shader* shader, bool multiview) {
+  lovrAssert(shader->type == SHADER_GRAPHICS, "Only graphics Shaders have multiview variants");
+  lovrAssert(!multiview || state.features.multiview, "Multiview is not supported on this system");
+  return initGraphicsProgram(variant, shader->sources[0], shader->sources[1], shader->sources[2], multiview, false);
+}
+
+// Compiling and linking are only issued when a graphics shader is created, so the driver can work on
+// them in the background (on its own threads, with KHR_parallel_shader_compile).  Querying any status
+// blocks until the work is done, so the checks and the uniform/attribute reflection are deferred until
+// the shader is first used.
+bool lovrShaderIsReady(Shader* shader) {
+  if (!shader->pending) {
+    return true;
+  }
+
+#ifndef LOVR_WEBGL
+  if (state.parallelCompile) {
+    GLint complete = GL_FALSE;
+    glGetProgramiv(shader->program, GL_COMPLETION_STATUS_KHR, &complete);
+    if (!complete) {
+      return false;
+    }
+  }
+#endif
+
+  lovrShaderWait(shader);
+  return true;
+}
+
+void lovrShaderWait(Shader* shader) {
+  if (!shader->pending) {
+    return;
+  }
+
+  GLuint program = shader->program;
+
+  if (shader->stages[0]) {
+    checkShader(shader->stages[0], GL_VERTEX_SHADER);
+    checkShader(shader->stages[1], GL_FRAGMENT_SHADER);
+    checkProgram(program);
+    glDetachShader(program, shader->stages[0]);
+    glDeleteShader(shader->stages[0]);
+    glDetachShader(program, shader->stages[1]);
+    glDeleteShader(shader->stages[1]);
+    shader->stages[0] = shader->stages[1] = 0;
+    saveCachedProgram(program, shader->cacheHash);
+  }
+
+  shader->pending = false;
 
   // Generic attributes
   lovrGpuUseProgram(program);
@@ -1961,6 +2497,11 @@ Shader* lovrShaderInitGraphics(Shader* shader, const char* vertexSource, const c
   glVertexAttribI4uiv(LOVR_SHADER_BONES, (uint32_t[4]) { 0., 0., 0., 0. });
   glVertexAttrib4fv(LOVR_SHADER_BONE_WEIGHTS, (float[4]) { 1., 0., 0., 0. });
   glVertexAttribI4ui(LOVR_SHADER_DRAW_ID, 0, 0, 0, 0);
+  glVertexAttrib4f(LOVR_SHADER_INSTANCE_TRANSFORM + 0, 1., 0., 0., 0.);
+  glVertexAttrib4f(LOVR_SHADER_INSTANCE_TRANSFORM + 1, 0., 1., 0., 0.);
+  glVertexAttrib4f(LOVR_SHADER_INSTANCE_TRANSFORM + 2, 0., 0., 1., 0.);
+  glVertexAttrib4f(LOVR_SHADER_INSTANCE_TRANSFORM + 3, 0., 0., 0., 1.);
+  glVertexAttrib4fv(LOVR_SHADER_INSTANCE_COLOR, (float[4]) { 1., 1., 1., 1. });
 
   lovrShaderSetupUniforms(shader);
 
@@ -1975,8 +2516,6 @@ Shader* lovrShaderInitGraphics(Shader* shader, const char* vertexSource, const c
     glGetActiveAttrib(program, i, LOVR_MAX_ATTRIBUTE_LENGTH, NULL, &size, &type, name);
     map_set(&shader->attributes, name, glGetAttribLocation(program, name));
   }
-
-  return shader;
 }
 
 Shader* lovrShaderInitCompute(Shader* shader, const char* source, ShaderFlag* flags, uint32_t flagCount) {
@@ -2003,7 +2542,15 @@ Shader* lovrShaderInitCompute(Shader* shader, const char* source, ShaderFlag* fl
 void lovrShaderDestroy(void* ref) {
   Shader* shader = ref;
   lovrGraphicsFlushShader(shader);
+  if (shader->stages[0]) {
+    glDeleteShader(shader->stages[0]);
+    glDeleteShader(shader->stages[1]);
+  }
   glDeleteProgram(shader->program);
+  lovrRelease(Shader, shader->variant);
+  for (int i = 0; i < 3; i++) {
+    free(shader->sources[i]);
+  }
   for (int i = 0; i < shader->uniforms.length; i++) {
     free(shader->uniforms.data[i].value.data);
   }
@@ -27,7 +27,11 @@
   uint32_t ibo;
 
 #define GPU_SHADER_FIELDS \
-  uint32_t program;
+  uint32_t program; \
+  uint32_t stages[2]; \
+  char* sources[3]; \
+  uint64_t cacheHash; \
+  bool pending;
 
 #define GPU_TEXTURE_FIELDS \
   GLuint id; \
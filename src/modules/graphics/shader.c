@@ -58,13 +58,13 @@ static const char* getUniformTypeName(const Uniform* uniform) {
   return "";
 }
 
-Shader* lovrShaderInitDefault(Shader* shader, DefaultShader type, ShaderFlag* flags, uint32_t flagCount) {
+Shader* lovrShaderInitDefault(Shader* shader, DefaultShader type, ShaderFlag* flags, uint32_t flagCount, bool multiview, bool async) {
   switch (type) {
-    case SHADER_UNLIT: return lovrShaderInitGraphics(shader, NULL, NULL, flags, flagCount);
-    case SHADER_CUBE: return lovrShaderInitGraphics(shader, lovrCubeVertexShader, lovrCubeFragmentShader, flags, flagCount);
-    case SHADER_PANO: return lovrShaderInitGraphics(shader, lovrCubeVertexShader, lovrPanoFragmentShader, flags, flagCount);
-    case SHADER_FONT: return lovrShaderInitGraphics(shader, NULL, lovrFontFragmentShader, flags, flagCount);
-    case SHADER_FILL: return lovrShaderInitGraphics(shader, lovrFillVertexShader, NULL, flags, flagCount);
+    case SHADER_UNLIT: return lovrShaderInitGraphics(shader, NULL, NULL, flags, flagCount, multiview, async);
+    case SHADER_CUBE: return lovrShaderInitGraphics(shader, lovrCubeVertexShader, lovrCubeFragmentShader, flags, flagCount, multiview, async);
+    case SHADER_PANO: return lovrShaderInitGraphics(shader, lovrCubeVertexShader, lovrPanoFragmentShader, flags, flagCount, multiview, async);
+    case SHADER_FONT: return lovrShaderInitGraphics(shader, NULL, lovrFontFragmentShader, flags, flagCount, multiview, async);
+    case SHADER_FILL: return lovrShaderInitGraphics(shader, lovrFillVertexShader, NULL, flags, flagCount, multiview, async);
     default: lovrThrow("Unknown default shader type"); return NULL;
   }
 }
@@ -74,15 +74,18 @@ ShaderType lovrShaderGetType(Shader* shader) {
 }
 
 int lovrShaderGetAttributeLocation(Shader* shader, const char* name) {
+  lovrShaderWait(shader);
   int* location = map_get(&shader->attributes, name);
   return location ? *location : -1;
 }
 
 bool lovrShaderHasUniform(Shader* shader, const char* name) {
+  lovrShaderWait(shader);
   return map_get(&shader->uniformMap, name) != NULL;
 }
 
 const Uniform* lovrShaderGetUniform(Shader* shader, const char* name) {
+  lovrShaderWait(shader);
   int* index = map_get(&shader->uniformMap, name);
   if (!index) {
     return false;
@@ -91,7 +94,13 @@ const Uniform* lovrShaderGetUniform(Shader* shader, const char* name) {
   return &shader->uniforms.data[*index];
 }
 
+// The multiview variant is a separate program, so it mirrors every uniform and block of its shader
 static void lovrShaderSetUniform(Shader* shader, const char* name, UniformType type, void* data, int start, int count, int size, const char* debug) {
+  if (shader->variant) {
+    lovrShaderSetUniform(shader->variant, name, type, data, start, count, size, debug);
+  }
+
+  lovrShaderWait(shader);
   int* index = map_get(&shader->uniformMap, name);
   if (!index) {
     return;
@@ -137,6 +146,11 @@ void lovrShaderSetColor(Shader* shader, const char* name, Color color) {
 }
 
 void lovrShaderSetBlock(Shader* shader, const char* name, Buffer* buffer, size_t offset, size_t size, UniformAccess access) {
+  if (shader->variant) {
+    lovrShaderSetBlock(shader->variant, name, buffer, offset, size, access);
+  }
+
+  lovrShaderWait(shader);
   int* id = map_get(&shader->blockMap, name);
   if (!id) return;
 
@@ -155,6 +169,46 @@ void lovrShaderSetBlock(Shader* shader, const char* name, Buffer* buffer, size_t
   }
 }
 
+// Returns a version of the shader that matches whether the Canvas is multiview, compiling it the
+// first time it's needed and copying the current uniforms and blocks into it
+Shader* lovrShaderGetVariant(Shader* shader, bool multiview) {
+  if (shader->multiview == multiview) {
+    return shader;
+  }
+
+  if (shader->variant) {
+    return shader->variant;
+  }
+
+  lovrShaderWait(shader);
+  Shader* variant = lovrShaderCreateVariant(shader, multiview);
+
+  Uniform* uniform; int i;
+  vec_foreach_ptr(&shader->uniforms, uniform, i) {
+    int* index = map_get(&variant->uniformMap, uniform->name);
+    if (index) {
+      Uniform* other = &variant->uniforms.data[*index];
+      if (other->type == uniform->type && other->size == uniform->size) {
+        memcpy(other->value.data, uniform->value.data, uniform->size);
+        other->dirty = true;
+      }
+    }
+  }
+
+  const char* key;
+  map_iter_t iter = map_iter(&shader->blockMap);
+  while ((key = map_next(&shader->blockMap, &iter)) != NULL) {
+    int id = *map_get(&shader->blockMap, key);
+    UniformBlock* block = &shader->blocks[id & 1].data[id >> 1];
+    if (block->source) {
+      lovrShaderSetBlock(variant, key, block->source, block->offset, block->size, block->access);
+    }
+  }
+
+  shader->variant = variant;
+  return variant;
+}
+
 // ShaderBlock
 
 // Calculates uniform size and byte offsets using std140 rules, returning the total buffer size
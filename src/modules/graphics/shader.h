@@ -116,19 +116,26 @@ typedef struct Shader {
   map_int_t attributes;
   map_int_t uniformMap;
   map_int_t blockMap;
+  bool multiview;
+  struct Shader* variant;
   GPU_SHADER_FIELDS
 } Shader;
 
 // Shader
 
-Shader* lovrShaderInitGraphics(Shader* shader, const char* vertexSource, const char* fragmentSource, ShaderFlag* flags, uint32_t flagCount);
+Shader* lovrShaderInitGraphics(Shader* shader, const char* vertexSource, const char* fragmentSource, ShaderFlag* flags, uint32_t flagCount, bool multiview, bool async);
 Shader* lovrShaderInitCompute(Shader* shader, const char* source, ShaderFlag* flags, uint32_t flagCount);
-Shader* lovrShaderInitDefault(Shader* shader, DefaultShader type, ShaderFlag* flags, uint32_t flagCount);
+Shader* lovrShaderInitDefault(Shader* shader, DefaultShader type, ShaderFlag* flags, uint32_t flagCount, bool multiview, bool async);
+Shader* lovrShaderInitVariant(Shader* variant, Shader* shader, bool multiview);
 #define lovrShaderCreateGraphics(...) lovrShaderInitGraphics(lovrAlloc(Shader), __VA_ARGS__)
 #define lovrShaderCreateCompute(...) lovrShaderInitCompute(lovrAlloc(Shader), __VA_ARGS__)
 #define lovrShaderCreateDefault(...) lovrShaderInitDefault(lovrAlloc(Shader), __VA_ARGS__)
+#define lovrShaderCreateVariant(...) lovrShaderInitVariant(lovrAlloc(Shader), __VA_ARGS__)
 void lovrShaderDestroy(void* ref);
+bool lovrShaderIsReady(Shader* shader);
+void lovrShaderWait(Shader* shader);
 ShaderType lovrShaderGetType(Shader* shader);
+Shader* lovrShaderGetVariant(Shader* shader, bool multiview);
 int lovrShaderGetAttributeLocation(Shader* shader, const char* name);
 bool lovrShaderHasUniform(Shader* shader, const char* name);
 const Uniform* lovrShaderGetUniform(Shader* shader, const char* name);
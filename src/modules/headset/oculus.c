@@ -5,6 +5,9 @@
 #include "graphics/texture.h"
 #include "core/maf.h"
 #include "lib/vec/vec.h"
+#ifdef LOVR_ENABLE_TIMER
+#include "timer/timer.h"
+#endif
 
 #include <stdbool.h>
 #include <OVR_CAPI.h>
@@ -376,7 +379,13 @@ static void oculus_renderTo(void (*callback)(void*), void* userdata) {
   }
 
   const ovrLayerHeader* layers = &ld.Header;
+#ifdef LOVR_ENABLE_TIMER
+  double start = lovrPlatformGetTime();
   ovr_SubmitFrame(state.session, 0, NULL, &layers, 1);
+  lovrTimerAddBlockedTime(lovrPlatformGetTime() - start);
+#else
+  ovr_SubmitFrame(state.session, 0, NULL, &layers, 1);
+#endif
 
   state.needRefreshTracking = true;
   state.needRefreshButtons = true;
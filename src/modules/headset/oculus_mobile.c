@@ -477,17 +477,21 @@ void bridgeLovrUpdate(BridgeLovrUpdateData *updateData) {
   }
 }
 
-static void lovrOculusMobileDraw(int framebuffer, int width, int height, float *eyeViewMatrix, float *projectionMatrix) {
+// With multiview, both eyes are drawn at once into the layers of the framebuffer's array texture
+static void lovrOculusMobileDraw(int framebuffer, int eye, bool multiview, int width, int height) {
   lovrGpuDirtyTexture();
 
   Canvas canvas = { 0 };
-  lovrCanvasInitFromHandle(&canvas, width, height, (CanvasFlags) { 0 }, framebuffer, 0, 0, 1, true);
-
-  Camera camera = { .canvas = &canvas, .stereo = false };
-  memcpy(camera.viewMatrix[0], eyeViewMatrix, sizeof(camera.viewMatrix[0]));
-  mat4_translate(camera.viewMatrix[0], 0, -state.offset, 0);
-
-  memcpy(camera.projection[0], projectionMatrix, sizeof(camera.projection[0]));
+  CanvasFlags flags = { .stereo = multiview, .multiview = multiview };
+  lovrCanvasInitFromHandle(&canvas, width, height, flags, framebuffer, 0, 0, 1, true);
+
+  Camera camera = { .canvas = &canvas, .stereo = multiview };
+  for (int i = 0; i < (multiview ? 2 : 1); i++) {
+    int view = multiview ? i : eye; // Is this indexing safe?
+    memcpy(camera.viewMatrix[i], bridgeLovrMobileData.updateData.eyeViewMatrix[view], sizeof(camera.viewMatrix[i]));
+    mat4_translate(camera.viewMatrix[i], 0, -state.offset, 0);
+    memcpy(camera.projection[i], bridgeLovrMobileData.updateData.projectionMatrix[view], sizeof(camera.projection[i]));
+  }
 
   lovrGraphicsSetCamera(&camera, true);
 
@@ -500,9 +504,12 @@ static void lovrOculusMobileDraw(int framebuffer, int width, int height, float *
 }
 
 void bridgeLovrDraw(BridgeLovrDrawData *drawData) {
-  int eye = drawData->eye;
-  lovrOculusMobileDraw(drawData->framebuffer, bridgeLovrMobileData.displayDimensions.width, bridgeLovrMobileData.displayDimensions.height,
-    bridgeLovrMobileData.updateData.eyeViewMatrix[eye], bridgeLovrMobileData.updateData.projectionMatrix[eye]); // Is this indexing safe?
+  lovrOculusMobileDraw(drawData->framebuffer, drawData->eye, drawData->multiview,
+    bridgeLovrMobileData.displayDimensions.width, bridgeLovrMobileData.displayDimensions.height);
+}
+
+bool bridgeLovrIsMultiviewSupported() {
+  return lovrGpuGetFeatures()->multiview;
 }
 
 // Android activity has been stopped or resumed
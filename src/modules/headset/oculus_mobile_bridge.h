@@ -129,13 +129,20 @@ LOVR_EXPORT void bridgeLovrInit(BridgeLovrInitData *initData);
 
 LOVR_EXPORT void bridgeLovrUpdate(BridgeLovrUpdateData *updateData);
 
+// When multiview is set, framebuffer has a 2 layer array texture attached with OVR_multiview (one
+// layer per eye) and both eyes are drawn in a single call, so eye is ignored.
 typedef struct {
   int eye;
   int framebuffer;
+  bool multiview;
 } BridgeLovrDrawData;
 
 LOVR_EXPORT void bridgeLovrDraw(BridgeLovrDrawData *drawData);
 
+// Whether the bridge should create 2D array swapchains and draw with multiview framebuffers.  Only
+// valid after bridgeLovrInit, once the graphics context exists.
+LOVR_EXPORT bool bridgeLovrIsMultiviewSupported(void);
+
 LOVR_EXPORT void bridgeLovrPaused(bool paused);
 
 LOVR_EXPORT void bridgeLovrClose();
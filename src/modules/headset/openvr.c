@@ -7,6 +7,9 @@
 #include "graphics/graphics.h"
 #include "graphics/canvas.h"
 #include "core/maf.h"
+#ifdef LOVR_ENABLE_TIMER
+#include "timer/timer.h"
+#endif
 #include "platform.h"
 #include <stdbool.h>
 #include <stdio.h>
@@ -578,7 +581,13 @@ static Texture* openvr_getMirrorTexture(void) {
 }
 
 static void openvr_update(float dt) {
+#ifdef LOVR_ENABLE_TIMER
+  double start = lovrPlatformGetTime();
+  state.compositor->WaitGetPoses(&state.renderPose, 1, NULL, 0);
+  lovrTimerAddBlockedTime(lovrPlatformGetTime() - start);
+#else
   state.compositor->WaitGetPoses(&state.renderPose, 1, NULL, 0);
+#endif
   VRActiveActionSet_t activeActionSet = { .ulActionSet = state.actionSet };
   state.input->UpdateActionState(&activeActionSet, sizeof(activeActionSet), 1);
 
@@ -4,6 +4,9 @@
 #include "graphics/canvas.h"
 #include "graphics/texture.h"
 #include "graphics/opengl.h"
+#ifdef LOVR_ENABLE_TIMER
+#include "timer/timer.h"
+#endif
 #include "util.h"
 #include <math.h>
 
@@ -612,7 +615,13 @@ static void openxr_renderTo(void (*callback)(void*), void* userdata) {
 static void openxr_update(float dt) {
   if (SESSION_RUNNING(state.sessionState)) {
     XrFrameState frameState;
+#ifdef LOVR_ENABLE_TIMER
+    double start = lovrPlatformGetTime();
+    XR(xrWaitFrame(state.session, NULL, &frameState));
+    lovrTimerAddBlockedTime(lovrPlatformGetTime() - start);
+#else
     XR(xrWaitFrame(state.session, NULL, &frameState));
+#endif
     state.displayTime = frameState.predictedDisplayTime;
 
     XrActiveActionSet set = { XR_TYPE_ACTIVE_ACTION_SET, NULL, state.actionSet, XR_NULL_PATH };
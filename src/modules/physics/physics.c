@@ -1,20 +1,66 @@
 #include "physics.h"
 #include "core/maf.h"
+#include "core/profiler.h"
+#include "data/modelData.h"
 #include "types.h"
+#ifdef LOVR_ENABLE_THREAD
+#include "lib/tinycthread/tinycthread.h"
+#include <setjmp.h>
+#include <stdio.h>
+#endif
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 
 static void defaultNearCallback(void* data, dGeomID a, dGeomID b) {
-  lovrWorldCollide((World*) data, dGeomGetData(a), dGeomGetData(b), -1, -1);
+  World* world = data;
+  world->stats.pairs++;
+  lovrWorldCollide(world, dGeomGetData(a), dGeomGetData(b), -1, -1);
 }
 
 static void customNearCallback(void* data, dGeomID shapeA, dGeomID shapeB) {
   World* world = data;
+  world->stats.pairs++;
   vec_push(&world->overlaps, dGeomGetData(shapeA));
   vec_push(&world->overlaps, dGeomGetData(shapeB));
 }
 
+// Static colliders live in their own space, which is never collided against itself
+static void collideWorld(World* world, dNearCallback* callback) {
+  dSpaceCollide(world->dynamicSpace, world, callback);
+  if (world->staticSpace != world->dynamicSpace) {
+    dSpaceCollide2((dGeomID) world->staticSpace, (dGeomID) world->dynamicSpace, world, callback);
+  }
+}
+
+static dSpaceID createSpace(dSpaceID parent, BroadphaseInfo* info) {
+  switch (info->type) {
+    case BROADPHASE_HASH: {
+      dSpaceID space = dHashSpaceCreate(parent);
+      dHashSpaceSetLevels(space, info->minLevel, info->maxLevel);
+      return space;
+    }
+    case BROADPHASE_SAP: return dSweepAndPruneSpaceCreate(parent, info->axisOrder);
+    case BROADPHASE_QUADTREE: {
+      dVector3 center = { info->center[0], info->center[1], info->center[2] };
+      dVector3 extents = { info->extents[0], info->extents[1], info->extents[2] };
+      return dQuadTreeSpaceCreate(parent, center, extents, info->depth);
+    }
+    case BROADPHASE_SIMPLE: return dSimpleSpaceCreate(parent);
+    default: lovrThrow("Unreachable");
+  }
+}
+
+static dSpaceID getColliderSpace(Collider* collider) {
+  return dBodyIsKinematic(collider->body) ? collider->world->staticSpace : collider->world->dynamicSpace;
+}
+
 static void raycastCallback(void* data, dGeomID a, dGeomID b) {
+  if (dGeomIsSpace(b)) {
+    dSpaceCollide2(a, b, data, raycastCallback);
+    return;
+  }
+
   RaycastCallback callback = ((RaycastData*) data)->callback;
   void* userdata = ((RaycastData*) data)->userdata;
   Shape* shape = dGeomGetData(b);
@@ -30,26 +76,354 @@ static void raycastCallback(void* data, dGeomID a, dGeomID b) {
   }
 }
 
+typedef struct {
+  RaycastMode mode;
+  uint32_t tagMask;
+  uint32_t ray;
+  RaycastHit* hits;
+  uint32_t count;
+  uint32_t capacity;
+  RaycastHit nearest;
+  bool found;
+} RaycastBatch;
+
+static void raycastBatchCallback(void* data, dGeomID a, dGeomID b) {
+  if (dGeomIsSpace(b)) {
+    dSpaceCollide2(a, b, data, raycastBatchCallback);
+    return;
+  }
+
+  RaycastBatch* batch = data;
+  Shape* shape = dGeomGetData(b);
+
+  if (!shape || !shape->collider || (batch->mode == RAYCAST_ANY && batch->found)) {
+    return;
+  }
+
+  int tag = shape->collider->tag;
+  if (batch->tagMask != ~0u && (tag == NO_TAG || !(batch->tagMask & (1 << tag)))) {
+    return;
+  }
+
+  dContactGeom contacts[MAX_CONTACTS];
+  int contactCount = dCollide(a, b, MAX_CONTACTS, contacts, sizeof(dContactGeom));
+
+  for (int i = 0; i < contactCount; i++) {
+    dContactGeom* g = &contacts[i];
+    RaycastHit hit = {
+      .shape = shape,
+      .ray = batch->ray,
+      .position = { g->pos[0], g->pos[1], g->pos[2] },
+      .normal = { g->normal[0], g->normal[1], g->normal[2] },
+      .distance = g->depth
+    };
+
+    if (batch->mode == RAYCAST_ALL) {
+      if (batch->count < batch->capacity) {
+        batch->hits[batch->count++] = hit;
+      }
+    } else if (!batch->found || hit.distance < batch->nearest.distance) {
+      batch->nearest = hit;
+      batch->found = true;
+    }
+  }
+}
+
+typedef struct {
+  uint32_t tagMask;
+  bool exact;
+  float aabb[6];
+  Shape** shapes;
+  uint32_t count;
+  uint32_t capacity;
+} QueryData;
+
+// The broadphase only reports candidates, they're filtered by tag and then tested against the query
+// volume (AABB queries stop at the bounding box test).  The count keeps going past the capacity so
+// callers can tell how big the result buffer needs to be.
+static void queryCallback(void* data, dGeomID a, dGeomID b) {
+  if (dGeomIsSpace(b)) {
+    dSpaceCollide2(a, b, data, queryCallback);
+    return;
+  }
+
+  QueryData* query = data;
+  Shape* shape = dGeomGetData(b);
+
+  if (!shape || !shape->collider) {
+    return;
+  }
+
+  int tag = shape->collider->tag;
+  if (query->tagMask != ~0u && (tag == NO_TAG || !(query->tagMask & (1 << tag)))) {
+    return;
+  }
+
+  if (query->exact) {
+    dContactGeom contact;
+    if (dCollide(a, b, 1, &contact, sizeof(dContactGeom)) == 0) {
+      return;
+    }
+  } else {
+    dReal aabb[6];
+    dGeomGetAABB(b, aabb);
+    for (int i = 0; i < 3; i++) {
+      if (aabb[2 * i] > query->aabb[2 * i + 1] || aabb[2 * i + 1] < query->aabb[2 * i]) {
+        return;
+      }
+    }
+  }
+
+  if (query->count < query->capacity) {
+    query->shapes[query->count] = shape;
+  }
+
+  query->count++;
+}
+
+static uint32_t queryWorld(World* world, dGeomID geom, QueryData* query) {
+  dSpaceCollide2(geom, (dGeomID) world->dynamicSpace, query, queryCallback);
+  if (world->staticSpace != world->dynamicSpace) {
+    dSpaceCollide2(geom, (dGeomID) world->staticSpace, query, queryCallback);
+  }
+  return query->count;
+}
+
 static bool initialized = false;
 
+// Worker pool for stepping independent Worlds concurrently.  Each World is updated entirely on one
+// thread with the default collision resolver; ODE keeps per-thread collision caches, so every worker
+// allocates its own ODE thread data.
+#ifdef LOVR_ENABLE_THREAD
+static struct {
+  thrd_t threads[MAX_PHYSICS_WORKERS];
+  uint32_t workerCount;
+  uint32_t starting;
+  bool startFailed;
+  mtx_t call;
+  mtx_t lock;
+  cnd_t wake;
+  cnd_t done;
+  World** worlds;
+  uint32_t worldCount;
+  uint32_t next;
+  uint32_t pending;
+  float dt;
+  bool quit;
+  char error[256];
+} pool;
+
+static void catchError(void* userdata, const char* format, va_list args) {
+  mtx_lock(&pool.lock);
+  if (!pool.error[0]) {
+    vsnprintf(pool.error, sizeof(pool.error), format, args);
+  }
+  mtx_unlock(&pool.lock);
+  longjmp(*(jmp_buf*) userdata, 1);
+}
+
+// Workers have no Lua state to unwind into, and the calling thread can't unwind while the pool still
+// references its worlds, so errors are recorded here and rethrown once every job has finished.
+static void runJob(World* world, float dt) {
+  lovrErrorHandler handler = lovrErrorCallback;
+  void* userdata = lovrErrorUserdata;
+  uint32_t depth = LOVR_ZONE_DEPTH();
+  jmp_buf env;
+  if (!setjmp(env)) {
+    lovrSetErrorCallback(catchError, &env);
+    lovrWorldUpdate(world, dt, NULL, NULL);
+  } else {
+    LOVR_ZONE_UNWIND(depth);
+  }
+  lovrSetErrorCallback(handler, userdata);
+}
+
+// Called with the lock held, returns with the lock held
+static void runJobs() {
+  while (pool.next < pool.worldCount) {
+    World* world = pool.worlds[pool.next++];
+    float dt = pool.dt;
+    mtx_unlock(&pool.lock);
+    runJob(world, dt);
+    mtx_lock(&pool.lock);
+    if (--pool.pending == 0) {
+      cnd_broadcast(&pool.done);
+    }
+  }
+}
+
+static int workerMain(void* arg) {
+  bool allocated = dAllocateODEDataForThread(dAllocateMaskAll);
+  mtx_lock(&pool.lock);
+  pool.starting--;
+  pool.startFailed |= !allocated;
+  cnd_broadcast(&pool.done);
+  while (allocated && !pool.quit) {
+    runJobs();
+    if (!pool.quit) {
+      cnd_wait(&pool.wake, &pool.lock);
+    }
+  }
+  mtx_unlock(&pool.lock);
+  if (allocated) {
+    dCleanupODEAllDataForThread();
+  }
+  LOVR_ZONE_RELEASE_THREAD();
+  return 0;
+}
+
+// Called with the call lock held
+static void stopWorkers() {
+  mtx_lock(&pool.lock);
+  pool.quit = true;
+  cnd_broadcast(&pool.wake);
+  mtx_unlock(&pool.lock);
+  for (uint32_t i = 0; i < pool.workerCount; i++) {
+    thrd_join(pool.threads[i], NULL);
+  }
+  pool.workerCount = 0;
+  pool.quit = false;
+}
+#endif
+
+// Every thread that uses physics needs its own ODE data, so threads after the first one only allocate
+// that and return false.  They should call lovrPhysicsDestroyThread when they're done.
 bool lovrPhysicsInit() {
-  if (initialized) return false;
-  dInitODE();
+  if (initialized) {
+    lovrAssert(dAllocateODEDataForThread(dAllocateMaskAll), "Could not allocate physics data for thread");
+    return false;
+  }
+  dInitODE2(0);
+  lovrAssert(dAllocateODEDataForThread(dAllocateMaskAll), "Could not allocate physics data for thread");
+#ifdef LOVR_ENABLE_THREAD
+  mtx_init(&pool.call, mtx_plain);
+  mtx_init(&pool.lock, mtx_plain);
+  cnd_init(&pool.wake);
+  cnd_init(&pool.done);
+#endif
   return initialized = true;
 }
 
 void lovrPhysicsDestroy() {
   if (!initialized) return;
+#ifdef LOVR_ENABLE_THREAD
+  lovrPhysicsSetWorkerCount(0);
+  cnd_destroy(&pool.done);
+  cnd_destroy(&pool.wake);
+  mtx_destroy(&pool.lock);
+  mtx_destroy(&pool.call);
+#endif
   dCloseODE();
   initialized = false;
 }
 
-World* lovrWorldInit(World* world, float xg, float yg, float zg, bool allowSleep, const char** tags, int tagCount) {
+void lovrPhysicsDestroyThread() {
+  dCleanupODEAllDataForThread();
+}
+
+uint32_t lovrPhysicsGetWorkerCount() {
+#ifdef LOVR_ENABLE_THREAD
+  return pool.workerCount;
+#else
+  return 0;
+#endif
+}
+
+void lovrPhysicsSetWorkerCount(uint32_t count) {
+#ifdef LOVR_ENABLE_THREAD
+  count = MIN(count, MAX_PHYSICS_WORKERS);
+  mtx_lock(&pool.call);
+  if (count == pool.workerCount) {
+    mtx_unlock(&pool.call);
+    return;
+  }
+
+  if (pool.workerCount > 0) {
+    stopWorkers();
+  }
+
+  mtx_lock(&pool.lock);
+  pool.startFailed = false;
+  while (pool.workerCount < count) {
+    if (thrd_create(&pool.threads[pool.workerCount], workerMain, NULL) != thrd_success) {
+      pool.startFailed = true;
+      break;
+    }
+    pool.workerCount++;
+    pool.starting++;
+  }
+  while (pool.starting > 0) {
+    cnd_wait(&pool.done, &pool.lock);
+  }
+  bool failed = pool.startFailed;
+  mtx_unlock(&pool.lock);
+
+  if (failed) {
+    stopWorkers();
+  }
+
+  mtx_unlock(&pool.call);
+  lovrAssert(!failed, "Could not start physics worker threads");
+#endif
+}
+
+// The calling thread also steps worlds, so this works (sequentially) without any workers.  Calls from
+// different threads are serialized, since they share the pool.
+void lovrPhysicsUpdateWorlds(World** worlds, uint32_t count, float dt) {
+  for (uint32_t i = 0; i < count; i++) {
+    for (uint32_t j = 0; j < i; j++) {
+      lovrAssert(worlds[i] != worlds[j], "A World can only be updated once per call");
+    }
+  }
+
+#ifdef LOVR_ENABLE_THREAD
+  mtx_lock(&pool.call);
+  mtx_lock(&pool.lock);
+  pool.worlds = worlds;
+  pool.worldCount = count;
+  pool.next = 0;
+  pool.pending = count;
+  pool.dt = dt;
+  pool.error[0] = '\0';
+  cnd_broadcast(&pool.wake);
+  runJobs();
+  while (pool.pending > 0) {
+    cnd_wait(&pool.done, &pool.lock);
+  }
+  pool.worlds = NULL;
+  pool.worldCount = 0;
+  char error[sizeof(pool.error)];
+  memcpy(error, pool.error, sizeof(error));
+  mtx_unlock(&pool.lock);
+  mtx_unlock(&pool.call);
+  lovrAssert(!error[0], "%s", error);
+#else
+  for (uint32_t i = 0; i < count; i++) {
+    lovrWorldUpdate(worlds[i], dt, NULL, NULL);
+  }
+#endif
+}
+
+World* lovrWorldInit(World* world, float xg, float yg, float zg, bool allowSleep, const char** tags, int tagCount, BroadphaseInfo* broadphase) {
+  BroadphaseInfo defaultBroadphase = { .type = BROADPHASE_HASH, .minLevel = -4, .maxLevel = 8 };
+  broadphase = broadphase ? broadphase : &defaultBroadphase;
   world->id = dWorldCreate();
-  world->space = dHashSpaceCreate(0);
-  dHashSpaceSetLevels(world->space, -4, 8);
+
+  // When static colliders are split off, the root space only holds the two subspaces
+  if (broadphase->splitStatic) {
+    world->space = dSimpleSpaceCreate(0);
+    world->staticSpace = createSpace(world->space, broadphase);
+    world->dynamicSpace = createSpace(world->space, broadphase);
+  } else {
+    world->space = createSpace(0, broadphase);
+    world->staticSpace = world->dynamicSpace = world->space;
+  }
+
   world->contactGroup = dJointGroupCreate(0);
+  world->threadCount = 1;
   vec_init(&world->overlaps);
+  vec_init(&world->contactShapes);
+  world->contactEpoch = 1;
   lovrWorldSetGravity(world, xg, yg, zg);
   lovrWorldSetSleepingAllowed(world, allowSleep);
   map_init(&world->tags);
@@ -59,6 +433,7 @@ World* lovrWorldInit(World* world, float xg, float yg, float zg, bool allowSleep
 
   for (int i = 0; i < MAX_TAGS; i++) {
     world->masks[i] = ~0;
+    world->contactMasks[i] = ~0;
   }
 
   return world;
@@ -69,6 +444,8 @@ void lovrWorldDestroy(void* ref) {
   lovrWorldDestroyData(world);
   vec_deinit(&world->overlaps);
   map_deinit(&world->tags);
+  lovrWorldSetContactCapacity(world, 0);
+  vec_deinit(&world->contactShapes);
 }
 
 void lovrWorldDestroyData(World* world) {
@@ -79,38 +456,201 @@ void lovrWorldDestroyData(World* world) {
   }
 
   if (world->contactGroup) {
+    if (world->contactJoints) {
+      memset(world->contactJoints, 0, world->contactCapacity * sizeof(dJointID));
+    }
     dJointGroupDestroy(world->contactGroup);
     world->contactGroup = NULL;
   }
 
+  if (world->queryBox) {
+    dGeomDestroy(world->queryBox);
+    world->queryBox = NULL;
+  }
+
+  if (world->querySphere) {
+    dGeomDestroy(world->querySphere);
+    world->querySphere = NULL;
+  }
+
   if (world->space) {
     dSpaceDestroy(world->space);
     world->space = NULL;
+    world->staticSpace = NULL;
+    world->dynamicSpace = NULL;
   }
 
   if (world->id) {
+    lovrWorldSetThreadCount(world, 1);
     dWorldDestroy(world->id);
     world->id = NULL;
   }
 }
 
-void lovrWorldUpdate(World* world, float dt, CollisionResolver resolver, void* userdata) {
+// Recorded contacts keep their Shapes alive until they are cleared.  Each Shape is retained once per
+// update (tracked with an epoch on the Shape) instead of once per contact, so a Shape touching many
+// things can't overflow its reference count.
+static void retainContactShape(World* world, Shape* shape) {
+  if (shape->contactWorld != world || shape->contactEpoch != world->contactEpoch) {
+    shape->contactWorld = world;
+    shape->contactEpoch = world->contactEpoch;
+    vec_push(&world->contactShapes, shape);
+    lovrRetain(shape);
+  }
+}
+
+// Contacts recorded by a World:collide outside of an update still have joints pointing at their
+// feedback slots, those are detached here so the slots can be reused or reallocated.
+static void clearContacts(World* world) {
+  for (uint32_t i = 0; i < world->contactCapacity; i++) {
+    if (world->contactJoints[i]) {
+      dJointSetFeedback(world->contactJoints[i], NULL);
+      world->contactJoints[i] = NULL;
+    }
+  }
+
+  for (int i = 0; i < world->contactShapes.length; i++) {
+    Shape* shape = world->contactShapes.data[i];
+    lovrRelease(Shape, shape);
+  }
+
+  vec_clear(&world->contactShapes);
+  world->contactEpoch++;
+  world->contactsWritten = 0;
+}
+
+static void saveTransform(Collider* collider) {
+  const dReal* p = dBodyGetPosition(collider->body);
+  const dReal* q = dBodyGetQuaternion(collider->body);
+  vec3_set(collider->lastPosition, p[0], p[1], p[2]);
+  quat_set(collider->lastOrientation, q[1], q[2], q[3], q[0]);
+}
+
+static void stepWorld(World* world, float dt, CollisionResolver resolver, void* userdata) {
+  uint32_t firstContact = world->contactsWritten;
+
+  LOVR_ZONE_BEGIN("collide");
   if (resolver) {
     resolver(world, userdata);
   } else {
-    dSpaceCollide(world->space, world, defaultNearCallback);
+    collideWorld(world, defaultNearCallback);
   }
+  LOVR_ZONE_END();
 
   if (dt > 0) {
+    LOVR_ZONE_BEGIN("dWorldQuickStep");
     dWorldQuickStep(world->id, dt);
+    LOVR_ZONE_END();
+  }
+
+  // Contact joints from this step wrote their forces into the feedback slots, convert to impulses.
+  // If the buffer wrapped during the step, only the slots that still belong to this step are read.
+  if (world->contactCapacity > 0) {
+    uint32_t start = MAX(firstContact, world->contactsWritten - MIN(world->contactsWritten, world->contactCapacity));
+    for (uint32_t i = start; i < world->contactsWritten; i++) {
+      uint32_t slot = i % world->contactCapacity;
+      dReal* force = world->contactFeedback[slot].f1;
+      world->contacts[slot].impulse = sqrtf(force[0] * force[0] + force[1] * force[1] + force[2] * force[2]) * dt;
+      world->contactJoints[slot] = NULL;
+    }
   }
 
   dJointGroupEmpty(world->contactGroup);
 }
 
+// With a fixed step, dt is accumulated and the world is advanced in steps of exactly 1 / rate, up
+// to maxSubsteps per call.  Time that would need more substeps than that is dropped.
+uint32_t lovrWorldUpdate(World* world, float dt, CollisionResolver resolver, void* userdata) {
+  LOVR_ZONE_BEGIN("lovrWorldUpdate");
+  memset(&world->stats, 0, sizeof(world->stats));
+  clearContacts(world);
+  uint32_t steps = 0;
+
+  if (world->stepSize > 0.f) {
+    world->accumulator += dt;
+
+    while (world->accumulator >= world->stepSize && steps < world->maxSubsteps) {
+      for (Collider* collider = world->head; collider; collider = collider->next) {
+        saveTransform(collider);
+      }
+
+      stepWorld(world, world->stepSize, resolver, userdata);
+      world->accumulator -= world->stepSize;
+      steps++;
+    }
+
+    if (world->accumulator >= world->stepSize) {
+      world->accumulator = fmodf(world->accumulator, world->stepSize);
+    }
+  } else {
+    stepWorld(world, dt, resolver, userdata);
+    steps = dt > 0;
+  }
+
+  LOVR_ZONE_END();
+  return steps;
+}
+
+void lovrWorldGetStep(World* world, float* rate, uint32_t* maxSubsteps) {
+  *rate = world->stepSize > 0.f ? 1.f / world->stepSize : 0.f;
+  *maxSubsteps = world->maxSubsteps;
+}
+
+void lovrWorldSetStep(World* world, float rate, uint32_t maxSubsteps) {
+  world->stepSize = rate > 0.f ? 1.f / rate : 0.f;
+  world->maxSubsteps = maxSubsteps;
+  world->accumulator = 0.f;
+
+  for (Collider* collider = world->head; collider; collider = collider->next) {
+    saveTransform(collider);
+  }
+}
+
+float lovrWorldGetInterpolation(World* world) {
+  return world->stepSize > 0.f ? world->accumulator / world->stepSize : 1.f;
+}
+
+const WorldStats* lovrWorldGetStats(World* world) {
+  return &world->stats;
+}
+
+uint32_t lovrWorldGetThreadCount(World* world) {
+  return world->threadCount;
+}
+
+// Uses ODE's built-in threading implementation to solve independent islands in parallel
+void lovrWorldSetThreadCount(World* world, uint32_t count) {
+  count = MAX(count, 1);
+  if (count == world->threadCount) {
+    return;
+  }
+
+  if (world->threading) {
+    dWorldSetStepThreadingImplementation(world->id, NULL, NULL);
+    dThreadingImplementationShutdownProcessing(world->threading);
+    dThreadingThreadPoolWaitIdleState(world->threadPool);
+    dThreadingFreeThreadPool(world->threadPool);
+    dThreadingFreeImplementation(world->threading);
+    world->threadPool = NULL;
+    world->threading = NULL;
+  }
+
+  if (count > 1) {
+    world->threading = dThreadingAllocateMultiThreadedImplementation();
+    lovrAssert(world->threading, "Could not create physics threading implementation");
+    world->threadPool = dThreadingAllocateThreadPool(count - 1, 0, dAllocateFlagBasicData, NULL);
+    lovrAssert(world->threadPool, "Could not create physics thread pool");
+    dThreadingThreadPoolServeMultiThreadedImplementation(world->threadPool, world->threading);
+    dWorldSetStepThreadingImplementation(world->id, dThreadingImplementationGetFunctions(world->threading), world->threading);
+  }
+
+  dWorldSetStepIslandsProcessingMaxThreadCount(world->id, count);
+  world->threadCount = count;
+}
+
 void lovrWorldComputeOverlaps(World* world) {
   vec_clear(&world->overlaps);
-  dSpaceCollide(world->space, world, customNearCallback);
+  collideWorld(world, customNearCallback);
 }
 
 int lovrWorldGetNextOverlap(World* world, Shape** a, Shape** b) {
@@ -124,6 +664,54 @@ int lovrWorldGetNextOverlap(World* world, Shape** a, Shape** b) {
   return 1;
 }
 
+// Returns the overlapping pairs found by the last lovrWorldComputeOverlaps, packed as [a, b, a, b, ...]
+Shape** lovrWorldGetOverlaps(World* world, uint32_t* pairCount) {
+  *pairCount = world->overlaps.length / 2;
+  return (Shape**) world->overlaps.data;
+}
+
+uint32_t lovrWorldQueryAABB(World* world, float aabb[6], uint32_t tagMask, Shape** shapes, uint32_t capacity) {
+  QueryData query = { .tagMask = tagMask, .exact = false, .shapes = shapes, .capacity = capacity };
+  memcpy(query.aabb, aabb, sizeof(query.aabb));
+
+  if (!world->queryBox) {
+    world->queryBox = dCreateBox(0, 1., 1., 1.);
+  }
+
+  // The box is shared with queryBox, so its rotation needs to be reset
+  dReal identity[4] = { 1., 0., 0., 0. };
+  dGeomBoxSetLengths(world->queryBox, MAX(aabb[1] - aabb[0], 0.f), MAX(aabb[3] - aabb[2], 0.f), MAX(aabb[5] - aabb[4], 0.f));
+  dGeomSetPosition(world->queryBox, (aabb[0] + aabb[1]) / 2.f, (aabb[2] + aabb[3]) / 2.f, (aabb[4] + aabb[5]) / 2.f);
+  dGeomSetQuaternion(world->queryBox, identity);
+  return queryWorld(world, world->queryBox, &query);
+}
+
+uint32_t lovrWorldQueryBox(World* world, float position[3], float orientation[4], float size[3], uint32_t tagMask, Shape** shapes, uint32_t capacity) {
+  QueryData query = { .tagMask = tagMask, .exact = true, .shapes = shapes, .capacity = capacity };
+
+  if (!world->queryBox) {
+    world->queryBox = dCreateBox(0, 1., 1., 1.);
+  }
+
+  dReal q[4] = { orientation[3], orientation[0], orientation[1], orientation[2] };
+  dGeomBoxSetLengths(world->queryBox, size[0], size[1], size[2]);
+  dGeomSetPosition(world->queryBox, position[0], position[1], position[2]);
+  dGeomSetQuaternion(world->queryBox, q);
+  return queryWorld(world, world->queryBox, &query);
+}
+
+uint32_t lovrWorldQuerySphere(World* world, float position[3], float radius, uint32_t tagMask, Shape** shapes, uint32_t capacity) {
+  QueryData query = { .tagMask = tagMask, .exact = true, .shapes = shapes, .capacity = capacity };
+
+  if (!world->querySphere) {
+    world->querySphere = dCreateSphere(0, 1.);
+  }
+
+  dGeomSphereSetRadius(world->querySphere, radius);
+  dGeomSetPosition(world->querySphere, position[0], position[1], position[2]);
+  return queryWorld(world, world->querySphere, &query);
+}
+
 int lovrWorldCollide(World* world, Shape* a, Shape* b, float friction, float restitution) {
   if (!a || !b) {
     return false;
@@ -160,14 +748,102 @@ int lovrWorldCollide(World* world, Shape* a, Shape* b, float friction, float res
 
   int contactCount = dCollide(a->id, b->id, MAX_CONTACTS, &contacts[0].geom, sizeof(dContact));
 
+  world->stats.contacts += contactCount;
+
+  bool record = world->contactCapacity > 0 && (tag1 == NO_TAG || tag2 == NO_TAG || (world->contactMasks[tag1] & (1 << tag2)));
+
   for (int i = 0; i < contactCount; i++) {
     dJointID joint = dJointCreateContact(world->id, world->contactGroup, &contacts[i]);
     dJointAttach(joint, colliderA->body, colliderB->body);
+
+    if (record) {
+      uint32_t slot = world->contactsWritten % world->contactCapacity;
+
+      // Overwriting a contact, detach its joint so the two don't share feedback
+      if (world->contactJoints[slot]) {
+        dJointSetFeedback(world->contactJoints[slot], NULL);
+      }
+
+      world->contactsWritten++;
+      retainContactShape(world, a);
+      retainContactShape(world, b);
+      dContactGeom* g = &contacts[i].geom;
+      world->contacts[slot] = (ContactEvent) {
+        .a = a,
+        .b = b,
+        .position = { g->pos[0], g->pos[1], g->pos[2] },
+        .normal = { g->normal[0], g->normal[1], g->normal[2] },
+        .depth = g->depth
+      };
+      memset(&world->contactFeedback[slot], 0, sizeof(dJointFeedback));
+      dJointSetFeedback(joint, &world->contactFeedback[slot]);
+      world->contactJoints[slot] = joint;
+    }
   }
 
   return contactCount;
 }
 
+uint32_t lovrWorldGetContactCapacity(World* world) {
+  return world->contactCapacity;
+}
+
+// Contacts are recorded into a ring buffer that is cleared at the start of every update, so once it
+// fills up the oldest contacts of the update are overwritten.  A capacity of zero disables recording.
+void lovrWorldSetContactCapacity(World* world, uint32_t capacity) {
+  clearContacts(world);
+  if (capacity == 0) {
+    free(world->contacts);
+    free(world->contactFeedback);
+    free(world->contactJoints);
+    world->contacts = NULL;
+    world->contactFeedback = NULL;
+    world->contactJoints = NULL;
+  } else {
+    world->contacts = realloc(world->contacts, capacity * sizeof(ContactEvent));
+    world->contactFeedback = realloc(world->contactFeedback, capacity * sizeof(dJointFeedback));
+    world->contactJoints = realloc(world->contactJoints, capacity * sizeof(dJointID));
+    lovrAssert(world->contacts && world->contactFeedback && world->contactJoints, "Out of memory");
+    memset(world->contactJoints, 0, capacity * sizeof(dJointID));
+  }
+  world->contactCapacity = capacity;
+}
+
+// Copies the contacts recorded during the last update, oldest first
+uint32_t lovrWorldGetContacts(World* world, ContactEvent* contacts, uint32_t capacity) {
+  uint32_t count = MIN(world->contactsWritten, world->contactCapacity);
+  uint32_t first = world->contactsWritten - count;
+  count = MIN(count, capacity);
+  for (uint32_t i = 0; i < count; i++) {
+    contacts[i] = world->contacts[(first + i) % world->contactCapacity];
+  }
+  return count;
+}
+
+int lovrWorldDisableContactsBetween(World* world, const char* tag1, const char* tag2) {
+  int* index1 = map_get(&world->tags, tag1);
+  int* index2 = map_get(&world->tags, tag2);
+  if (!index1 || !index2) {
+    return NO_TAG;
+  }
+
+  world->contactMasks[*index1] &= ~(1 << *index2);
+  world->contactMasks[*index2] &= ~(1 << *index1);
+  return 0;
+}
+
+int lovrWorldEnableContactsBetween(World* world, const char* tag1, const char* tag2) {
+  int* index1 = map_get(&world->tags, tag1);
+  int* index2 = map_get(&world->tags, tag2);
+  if (!index1 || !index2) {
+    return NO_TAG;
+  }
+
+  world->contactMasks[*index1] |= (1 << *index2);
+  world->contactMasks[*index2] |= (1 << *index1);
+  return 0;
+}
+
 void lovrWorldGetGravity(World* world, float* x, float* y, float* z) {
   dReal gravity[3];
   dWorldGetGravity(world->id, gravity);
@@ -214,12 +890,225 @@ void lovrWorldRaycast(World* world, float x1, float y1, float z1, float x2, floa
   float dy = y2 - y1;
   float dz = z2 - z1;
   float length = sqrtf(dx * dx + dy * dy + dz * dz);
-  dGeomID ray = dCreateRay(world->space, length);
+  dGeomID ray = dCreateRay(0, length);
   dGeomRaySet(ray, x1, y1, z1, dx, dy, dz);
   dSpaceCollide2(ray, (dGeomID) world->space, &data, raycastCallback);
   dGeomDestroy(ray);
 }
 
+// Rays are packed as 6 floats each (start and end point).  One ray geom is reused for the whole batch.
+// dSpaceCollide2 cleans the world's space and updates its bounding boxes, so batches on the same World
+// must not run concurrently with each other or with an update.
+uint32_t lovrWorldRaycastBatch(World* world, const float* rays, uint32_t rayCount, RaycastMode mode, uint32_t tagMask, RaycastHit* hits, uint32_t maxHits) {
+  RaycastBatch batch = { .mode = mode, .tagMask = tagMask, .hits = hits, .capacity = maxHits };
+  dGeomID ray = dCreateRay(0, 1.f);
+  dGeomRaySetClosestHit(ray, mode != RAYCAST_ALL);
+  dGeomRaySetFirstContact(ray, mode == RAYCAST_ANY);
+
+  for (uint32_t i = 0; i < rayCount && batch.count < maxHits; i++) {
+    const float* r = rays + 6 * i;
+    float dx = r[3] - r[0];
+    float dy = r[4] - r[1];
+    float dz = r[5] - r[2];
+    float length = sqrtf(dx * dx + dy * dy + dz * dz);
+
+    if (length == 0.f) {
+      continue;
+    }
+
+    batch.ray = i;
+    batch.found = false;
+    dGeomRaySetLength(ray, length);
+    dGeomRaySet(ray, r[0], r[1], r[2], dx, dy, dz);
+    dSpaceCollide2(ray, (dGeomID) world->space, &batch, raycastBatchCallback);
+
+    if (batch.found) {
+      hits[batch.count++] = batch.nearest;
+    }
+  }
+
+  dGeomDestroy(ray);
+  return batch.count;
+}
+
+uint32_t lovrWorldGetColliderCount(World* world) {
+  return world->colliderCount;
+}
+
+// POSE_STATE is position, orientation quaternion (xyzw), linear velocity and angular velocity.
+// POSE_MATRIX is a column-major transform, suitable for instanced drawing.
+// Interpolated poses blend between the last two fixed steps, lagging the simulation by up to one step
+static void writePose(Collider* collider, PoseFormat format, float alpha, float* data) {
+  const dReal* p = dBodyGetPosition(collider->body);
+  const dReal* q = dBodyGetQuaternion(collider->body);
+  float position[3] = { p[0], p[1], p[2] };
+  float orientation[4] = { q[1], q[2], q[3], q[0] };
+
+  if (alpha < 1.f) {
+    float current[4];
+    vec3_init(current, position);
+    vec3_lerp(vec3_init(position, collider->lastPosition), current, alpha);
+    quat_init(current, orientation);
+    quat_slerp(quat_init(orientation, collider->lastOrientation), current, alpha);
+  }
+
+  if (format == POSE_MATRIX) {
+    mat4_identity(data);
+    mat4_translate(data, position[0], position[1], position[2]);
+    mat4_rotateQuat(data, orientation);
+    return;
+  }
+
+  const dReal* v = dBodyGetLinearVel(collider->body);
+  const dReal* w = dBodyGetAngularVel(collider->body);
+  data[0] = position[0], data[1] = position[1], data[2] = position[2];
+  data[3] = orientation[0], data[4] = orientation[1], data[5] = orientation[2], data[6] = orientation[3];
+  data[7] = v[0], data[8] = v[1], data[9] = v[2];
+  data[10] = w[0], data[11] = w[1], data[12] = w[2];
+}
+
+static void readPose(Collider* collider, PoseFormat format, const float* data) {
+  float position[3], orientation[4];
+
+  if (format == POSE_MATRIX) {
+    mat4_getPosition((float*) data, position);
+    mat4_getOrientation((float*) data, orientation);
+  } else {
+    vec3_init(position, (float*) data);
+    quat_init(orientation, (float*) data + 3);
+    dBodySetLinearVel(collider->body, data[7], data[8], data[9]);
+    dBodySetAngularVel(collider->body, data[10], data[11], data[12]);
+  }
+
+  dReal q[4] = { orientation[3], orientation[0], orientation[1], orientation[2] };
+  dBodySetPosition(collider->body, position[0], position[1], position[2]);
+  dBodySetQuaternion(collider->body, q);
+  saveTransform(collider);
+}
+
+// If colliders is NULL, the world's colliders are used in list order (see lovrWorldGetColliders)
+uint32_t lovrWorldGetPoses(World* world, Collider** colliders, uint32_t count, PoseFormat format, bool interpolate, float* data) {
+  uint32_t stride = format == POSE_MATRIX ? POSE_MATRIX_FLOATS : POSE_STATE_FLOATS;
+  float alpha = interpolate ? lovrWorldGetInterpolation(world) : 1.f;
+  uint32_t i = 0;
+
+  if (colliders) {
+    for (; i < count; i++) {
+      writePose(colliders[i], format, alpha, data + i * stride);
+    }
+  } else {
+    for (Collider* collider = world->head; collider && i < count; collider = collider->next, i++) {
+      writePose(collider, format, alpha, data + i * stride);
+    }
+  }
+
+  return i;
+}
+
+uint32_t lovrWorldSetPoses(World* world, Collider** colliders, uint32_t count, PoseFormat format, const float* data) {
+  uint32_t stride = format == POSE_MATRIX ? POSE_MATRIX_FLOATS : POSE_STATE_FLOATS;
+  uint32_t i = 0;
+
+  if (colliders) {
+    for (; i < count; i++) {
+      readPose(colliders[i], format, data + i * stride);
+    }
+  } else {
+    for (Collider* collider = world->head; collider && i < count; collider = collider->next, i++) {
+      readPose(collider, format, data + i * stride);
+    }
+  }
+
+  return i;
+}
+
+#define STATE_MAGIC 0x5352564c // LVRS
+#define STATE_VERSION 1
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t colliderCount;
+  uint32_t realSize;
+  float accumulator;
+} StateHeader;
+
+// Raw ODE values are stored so a restored world resimulates bit for bit
+typedef struct {
+  dReal position[3];
+  dReal orientation[4];
+  dReal linearVelocity[3];
+  dReal angularVelocity[3];
+  dReal force[3];
+  dReal torque[3];
+  float lastPosition[3];
+  float lastOrientation[4];
+  uint32_t enabled;
+} BodyState;
+
+size_t lovrWorldGetStateSize(World* world) {
+  return sizeof(StateHeader) + world->colliderCount * sizeof(BodyState);
+}
+
+// Snapshots hold the dynamic state of every collider in list order.  Joints have no state of their own
+// in ODE (besides the bodies they connect) and contact joints only live for a single step, so the
+// snapshot is only valid for a world with the same colliders (e.g. for rollback and resimulation).
+void lovrWorldSaveState(World* world, void* data) {
+  StateHeader* header = data;
+  header->magic = STATE_MAGIC;
+  header->version = STATE_VERSION;
+  header->colliderCount = world->colliderCount;
+  header->realSize = sizeof(dReal);
+  header->accumulator = world->accumulator;
+
+  BodyState* state = (BodyState*) (header + 1);
+  for (Collider* collider = world->head; collider; collider = collider->next, state++) {
+    dBodyID body = collider->body;
+    memcpy(state->position, dBodyGetPosition(body), sizeof(state->position));
+    memcpy(state->orientation, dBodyGetQuaternion(body), sizeof(state->orientation));
+    memcpy(state->linearVelocity, dBodyGetLinearVel(body), sizeof(state->linearVelocity));
+    memcpy(state->angularVelocity, dBodyGetAngularVel(body), sizeof(state->angularVelocity));
+    memcpy(state->force, dBodyGetForce(body), sizeof(state->force));
+    memcpy(state->torque, dBodyGetTorque(body), sizeof(state->torque));
+    memcpy(state->lastPosition, collider->lastPosition, sizeof(state->lastPosition));
+    memcpy(state->lastOrientation, collider->lastOrientation, sizeof(state->lastOrientation));
+    state->enabled = dBodyIsEnabled(body);
+  }
+}
+
+void lovrWorldRestoreState(World* world, const void* data, size_t size) {
+  const StateHeader* header = data;
+  lovrAssert(size >= sizeof(StateHeader) && header->magic == STATE_MAGIC, "Invalid world state");
+  lovrAssert(header->version == STATE_VERSION && header->realSize == sizeof(dReal), "World state was saved by an incompatible version");
+  lovrAssert(header->colliderCount == world->colliderCount, "World state has %d colliders, but the World has %d", header->colliderCount, world->colliderCount);
+  lovrAssert(size >= lovrWorldGetStateSize(world), "World state is truncated");
+  world->accumulator = header->accumulator;
+
+  const BodyState* state = (const BodyState*) (header + 1);
+  for (Collider* collider = world->head; collider; collider = collider->next, state++) {
+    dBodyID body = collider->body;
+    dBodySetPosition(body, state->position[0], state->position[1], state->position[2]);
+    dBodySetQuaternion(body, state->orientation);
+    dBodySetLinearVel(body, state->linearVelocity[0], state->linearVelocity[1], state->linearVelocity[2]);
+    dBodySetAngularVel(body, state->angularVelocity[0], state->angularVelocity[1], state->angularVelocity[2]);
+    dBodySetForce(body, state->force[0], state->force[1], state->force[2]);
+    dBodySetTorque(body, state->torque[0], state->torque[1], state->torque[2]);
+    memcpy(collider->lastPosition, state->lastPosition, sizeof(state->lastPosition));
+    memcpy(collider->lastOrientation, state->lastOrientation, sizeof(state->lastOrientation));
+
+    if (state->enabled) {
+      dBodyEnable(body);
+    } else {
+      dBodyDisable(body);
+    }
+  }
+}
+
+int lovrWorldGetTag(World* world, const char* name) {
+  int* index = map_get(&world->tags, name);
+  return index ? *index : NO_TAG;
+}
+
 const char* lovrWorldGetTagName(World* world, int tag) {
   if (tag == NO_TAG) {
     return NULL;
@@ -281,6 +1170,7 @@ Collider* lovrColliderInit(Collider* collider, World* world, float x, float y, f
   vec_init(&collider->joints);
 
   lovrColliderSetPosition(collider, x, y, z);
+  saveTransform(collider);
 
   // Adjust the world's collider list
   if (!collider->world->head) {
@@ -291,6 +1181,8 @@ Collider* lovrColliderInit(Collider* collider, World* world, float x, float y, f
     collider->world->head = collider;
   }
 
+  world->colliderCount++;
+
   // The world owns a reference to the collider
   lovrRetain(collider);
   return collider;
@@ -327,6 +1219,7 @@ void lovrColliderDestroyData(Collider* collider) {
   if (collider->prev) collider->prev->next = collider->next;
   if (collider->world->head == collider) collider->world->head = collider->next;
   collider->next = collider->prev = NULL;
+  collider->world->colliderCount--;
 
   // If the Collider is destroyed, the world lets go of its reference to this Collider
   lovrRelease(Collider, collider);
@@ -336,7 +1229,9 @@ World* lovrColliderGetWorld(Collider* collider) {
   return collider->world;
 }
 
+// Terrain can't move, so it's only allowed on kinematic colliders
 void lovrColliderAddShape(Collider* collider, Shape* shape) {
+  lovrAssert(shape->type != SHAPE_TERRAIN || dBodyIsKinematic(collider->body), "TerrainShapes can only be added to kinematic Colliders");
   lovrRetain(shape);
 
   if (shape->collider) {
@@ -345,13 +1240,12 @@ void lovrColliderAddShape(Collider* collider, Shape* shape) {
 
   shape->collider = collider;
   dGeomSetBody(shape->id, collider->body);
-  dSpaceID newSpace = collider->world->space;
-  dSpaceAdd(newSpace, shape->id);
+  dSpaceAdd(getColliderSpace(collider), shape->id);
 }
 
 void lovrColliderRemoveShape(Collider* collider, Shape* shape) {
   if (shape->collider == collider) {
-    dSpaceRemove(collider->world->space, shape->id);
+    dSpaceRemove(dGeomGetSpace(shape->id), shape->id);
     dGeomSetBody(shape->id, 0);
     shape->collider = NULL;
     lovrRelease(Shape, shape);
@@ -430,11 +1324,26 @@ bool lovrColliderIsKinematic(Collider* collider) {
 }
 
 void lovrColliderSetKinematic(Collider* collider, bool kinematic) {
+  if (!kinematic) {
+    for (dGeomID geom = dBodyGetFirstGeom(collider->body); geom; geom = dBodyGetNextGeom(geom)) {
+      Shape* shape = dGeomGetData(geom);
+      lovrAssert(!shape || shape->type != SHAPE_TERRAIN, "Colliders with a TerrainShape must stay kinematic");
+    }
+  }
+
   if (kinematic) {
     dBodySetKinematic(collider->body);
   } else {
     dBodySetDynamic(collider->body);
   }
+
+  dSpaceID space = getColliderSpace(collider);
+  for (dGeomID geom = dBodyGetFirstGeom(collider->body); geom; geom = dBodyGetNextGeom(geom)) {
+    if (dGeomGetSpace(geom) != space) {
+      dSpaceRemove(dGeomGetSpace(geom), geom);
+      dSpaceAdd(space, geom);
+    }
+  }
 }
 
 bool lovrColliderIsGravityIgnored(Collider* collider) {
@@ -513,6 +1422,7 @@ void lovrColliderGetPosition(Collider* collider, float* x, float* y, float* z) {
 
 void lovrColliderSetPosition(Collider* collider, float x, float y, float z) {
   dBodySetPosition(collider->body, x, y, z);
+  vec3_set(collider->lastPosition, x, y, z);
 }
 
 void lovrColliderGetOrientation(Collider* collider, float* angle, float* x, float* y, float* z) {
@@ -526,6 +1436,7 @@ void lovrColliderSetOrientation(Collider* collider, float angle, float x, float
   quat_fromAngleAxis(quaternion, angle, x, y, z);
   float q[4] = { quaternion[3], quaternion[0], quaternion[1], quaternion[2] };
   dBodySetQuaternion(collider->body, q);
+  quat_init(collider->lastOrientation, quaternion);
 }
 
 void lovrColliderGetLinearVelocity(Collider* collider, float* x, float* y, float* z) {
@@ -670,6 +1581,20 @@ void lovrShapeDestroyData(Shape* shape) {
     dGeomDestroy(shape->id);
     shape->id = NULL;
   }
+
+  if (shape->type == SHAPE_MESH && shape->mesh.data) {
+    dGeomTriMeshDataDestroy(shape->mesh.data);
+    if (shape->mesh.ownsVertices) free(shape->mesh.vertices);
+    if (shape->mesh.ownsIndices) free(shape->mesh.indices);
+    lovrGenericRelease(shape->mesh.modelData);
+    memset(&shape->mesh, 0, sizeof(shape->mesh));
+  }
+
+  if (shape->type == SHAPE_TERRAIN && shape->terrain.data) {
+    dGeomHeightfieldDataDestroy(shape->terrain.data);
+    free(shape->terrain.heights);
+    memset(&shape->terrain, 0, sizeof(shape->terrain));
+  }
 }
 
 ShapeType lovrShapeGetType(Shape* shape) {
@@ -754,6 +1679,15 @@ void lovrShapeGetMass(Shape* shape, float density, float* cx, float* cy, float*
       dMassSetCylinder(&m, density, 3, radius, length);
       break;
     }
+
+    case SHAPE_MESH: {
+      dMassSetTrimesh(&m, density, shape->id);
+      dMassTranslate(&m, -m.c[0], -m.c[1], -m.c[2]);
+      break;
+    }
+
+    // Terrain is meant to be static, it doesn't contribute any mass
+    case SHAPE_TERRAIN: break;
   }
 
   const dReal* position = dGeomGetOffsetPosition(shape->id);
@@ -869,6 +1803,339 @@ void lovrCylinderShapeSetLength(CylinderShape* cylinder, float length) {
   dGeomCylinderSetParams(cylinder->id, lovrCylinderShapeGetRadius(cylinder), length);
 }
 
+#define MESH_CACHE_MAGIC 0x4d52564c // LVRM
+#define MESH_CACHE_VERSION 1
+
+// ODE keeps pointers to the vertex and index data instead of copying it.  The triangle flags are the
+// result of the (slow) preprocessing step, so they are stored in serialized meshes and restored.
+static MeshShape* buildMesh(MeshShape* mesh, const uint8_t* flags) {
+  mesh->type = SHAPE_MESH;
+  mesh->mesh.data = dGeomTriMeshDataCreate();
+  dGeomTriMeshDataBuildSingle(mesh->mesh.data, mesh->mesh.vertices, mesh->mesh.vertexStride, mesh->mesh.vertexCount, mesh->mesh.indices, mesh->mesh.indexCount, 3 * sizeof(uint32_t));
+
+  if (flags) {
+    dGeomTriMeshDataSet(mesh->mesh.data, dTRIMESHDATA_USE_FLAGS, (void*) flags);
+  } else {
+    dGeomTriMeshDataPreprocess2(mesh->mesh.data, (1U << dTRIDATAPREPROCESS_BUILD_CONCAVE_EDGES), NULL);
+  }
+
+  mesh->id = dCreateTriMesh(0, mesh->mesh.data, NULL, NULL, NULL);
+  dGeomSetData(mesh->id, mesh);
+  return mesh;
+}
+
+// Takes ownership of the vertices and indices, which must be allocated with malloc
+MeshShape* lovrMeshShapeInit(MeshShape* mesh, float* vertices, uint32_t vertexCount, uint32_t* indices, uint32_t indexCount) {
+  lovrAssert(indexCount % 3 == 0, "Mesh index count must be a multiple of 3");
+  for (uint32_t i = 0; i < indexCount; i++) {
+    lovrAssert(indices[i] < vertexCount, "Invalid mesh index %d (only %d vertices)", indices[i], vertexCount);
+  }
+
+  mesh->mesh.vertices = vertices;
+  mesh->mesh.vertexCount = vertexCount;
+  mesh->mesh.vertexStride = 3 * sizeof(float);
+  mesh->mesh.indices = indices;
+  mesh->mesh.indexCount = indexCount;
+  mesh->mesh.ownsVertices = true;
+  mesh->mesh.ownsIndices = true;
+  return buildMesh(mesh, NULL);
+}
+
+static bool isTriangleList(ModelPrimitive* primitive) {
+  ModelAttribute* position = primitive->attributes[ATTR_POSITION];
+  return primitive->mode == DRAW_TRIANGLES && position && position->type == F32 && position->components == 3;
+}
+
+static void countNodeTriangles(ModelData* modelData, uint32_t nodeIndex, uint32_t* vertexCount, uint32_t* indexCount) {
+  ModelNode* node = &modelData->nodes[nodeIndex];
+  for (uint32_t i = 0; i < node->primitiveCount; i++) {
+    ModelPrimitive* primitive = &modelData->primitives[node->primitiveIndex + i];
+    if (isTriangleList(primitive)) {
+      *vertexCount += primitive->attributes[ATTR_POSITION]->count;
+      *indexCount += primitive->indices ? primitive->indices->count : primitive->attributes[ATTR_POSITION]->count;
+    }
+  }
+
+  for (uint32_t i = 0; i < node->childCount; i++) {
+    countNodeTriangles(modelData, node->children[i], vertexCount, indexCount);
+  }
+}
+
+static void gatherNodeTriangles(ModelData* modelData, uint32_t nodeIndex, mat4 parent, float** vertices, uint32_t** indices, uint32_t* baseVertex) {
+  ModelNode* node = &modelData->nodes[nodeIndex];
+  float transform[16];
+  mat4_multiply(mat4_init(transform, parent), node->transform);
+
+  for (uint32_t i = 0; i < node->primitiveCount; i++) {
+    ModelPrimitive* primitive = &modelData->primitives[node->primitiveIndex + i];
+    if (!isTriangleList(primitive)) {
+      continue;
+    }
+
+    ModelAttribute* position = primitive->attributes[ATTR_POSITION];
+    ModelBuffer* buffer = &modelData->buffers[position->buffer];
+    size_t stride = buffer->stride ? buffer->stride : 3 * sizeof(float);
+    char* data = buffer->data + position->offset;
+    for (uint32_t j = 0; j < position->count; j++, data += stride, *vertices += 3) {
+      memcpy(*vertices, data, 3 * sizeof(float));
+      mat4_transform(transform, *vertices);
+    }
+
+    ModelAttribute* index = primitive->indices;
+    if (index) {
+      AttributeData indexData = { .raw = modelData->buffers[index->buffer].data + index->offset };
+      for (uint32_t j = 0; j < index->count; j++) {
+        switch (index->type) {
+          case U8: *(*indices)++ = *baseVertex + indexData.u8[j]; break;
+          case U16: *(*indices)++ = *baseVertex + indexData.u16[j]; break;
+          case U32: *(*indices)++ = *baseVertex + indexData.u32[j]; break;
+          default: lovrThrow("Unreachable");
+        }
+      }
+    } else {
+      for (uint32_t j = 0; j < position->count; j++) {
+        *(*indices)++ = *baseVertex + j;
+      }
+    }
+
+    *baseVertex += position->count;
+  }
+
+  for (uint32_t i = 0; i < node->childCount; i++) {
+    gatherNodeTriangles(modelData, node->children[i], transform, vertices, indices, baseVertex);
+  }
+}
+
+// Triangles are in the node's local space.  A leaf node with a single float position attribute and
+// 32 bit indices is referenced in place (the ModelData is kept alive), otherwise the node and its
+// children are flattened into a new vertex/index list.
+MeshShape* lovrMeshShapeInitFromModelData(MeshShape* mesh, ModelData* modelData, uint32_t nodeIndex) {
+  lovrAssert(nodeIndex < modelData->nodeCount, "Invalid node index %d", nodeIndex);
+  ModelNode* node = &modelData->nodes[nodeIndex];
+
+  if (node->childCount == 0 && node->primitiveCount == 1) {
+    ModelPrimitive* primitive = &modelData->primitives[node->primitiveIndex];
+    ModelAttribute* index = primitive->indices;
+    if (isTriangleList(primitive) && index && index->type == U32) {
+      ModelAttribute* position = primitive->attributes[ATTR_POSITION];
+      ModelBuffer* buffer = &modelData->buffers[position->buffer];
+      mesh->mesh.vertices = (float*) (buffer->data + position->offset);
+      mesh->mesh.vertexCount = position->count;
+      mesh->mesh.vertexStride = buffer->stride ? buffer->stride : 3 * sizeof(float);
+      mesh->mesh.indices = (uint32_t*) (modelData->buffers[index->buffer].data + index->offset);
+      mesh->mesh.indexCount = index->count;
+      mesh->mesh.modelData = modelData;
+      lovrRetain(modelData);
+      return buildMesh(mesh, NULL);
+    }
+  }
+
+  uint32_t vertexCount = 0;
+  uint32_t indexCount = 0;
+  countNodeTriangles(modelData, nodeIndex, &vertexCount, &indexCount);
+  lovrAssert(indexCount > 0, "Model node %d does not contain any triangles", nodeIndex);
+
+  float* vertices = malloc(3 * vertexCount * sizeof(float));
+  uint32_t* indices = malloc(indexCount * sizeof(uint32_t));
+  lovrAssert(vertices && indices, "Out of memory");
+
+  float* v = vertices;
+  uint32_t* i = indices;
+  uint32_t baseVertex = 0;
+
+  // The node's own transform places it in its parent, it shouldn't be applied to its own triangles
+  float inverse[16];
+  mat4_invert(mat4_init(inverse, node->transform));
+  gatherNodeTriangles(modelData, nodeIndex, inverse, &v, &i, &baseVertex);
+
+  return lovrMeshShapeInit(mesh, vertices, vertexCount, indices, indexCount);
+}
+
+MeshShape* lovrMeshShapeInitFromCache(MeshShape* mesh, const void* data, size_t size) {
+  const uint32_t* header = data;
+  lovrAssert(size >= 4 * sizeof(uint32_t) && header[0] == MESH_CACHE_MAGIC, "Invalid mesh cache");
+  lovrAssert(header[1] == MESH_CACHE_VERSION, "Unsupported mesh cache version %d", header[1]);
+  uint32_t vertexCount = header[2];
+  uint32_t indexCount = header[3];
+  lovrAssert(indexCount % 3 == 0, "Mesh index count must be a multiple of 3");
+
+  // Sizes are checked against the remaining bytes one at a time so a bogus header can't overflow them
+  size_t remaining = size - 4 * sizeof(uint32_t);
+  lovrAssert(vertexCount <= remaining / (3 * sizeof(float)), "Mesh cache is truncated");
+  size_t vertexSize = 3 * (size_t) vertexCount * sizeof(float);
+  remaining -= vertexSize;
+  lovrAssert(indexCount <= remaining / sizeof(uint32_t), "Mesh cache is truncated");
+  size_t indexSize = (size_t) indexCount * sizeof(uint32_t);
+  remaining -= indexSize;
+  size_t flagSize = indexCount / 3;
+  lovrAssert(flagSize <= remaining, "Mesh cache is truncated");
+
+  // The flags are stored after the indices so one allocation holds both
+  const char* body = (const char*) (header + 4);
+  const uint32_t* cachedIndices = (const uint32_t*) (body + vertexSize);
+  for (uint32_t i = 0; i < indexCount; i++) {
+    lovrAssert(cachedIndices[i] < vertexCount, "Invalid mesh index %d (only %d vertices)", cachedIndices[i], vertexCount);
+  }
+
+  float* vertices = malloc(vertexSize);
+  uint32_t* indices = malloc(indexSize + flagSize);
+  if (!vertices || !indices) {
+    free(vertices);
+    free(indices);
+    lovrThrow("Out of memory");
+  }
+
+  memcpy(vertices, body, vertexSize);
+  memcpy(indices, body + vertexSize, indexSize + flagSize);
+
+  mesh->mesh.vertices = vertices;
+  mesh->mesh.vertexCount = vertexCount;
+  mesh->mesh.vertexStride = 3 * sizeof(float);
+  mesh->mesh.indices = indices;
+  mesh->mesh.indexCount = indexCount;
+  mesh->mesh.ownsVertices = true;
+  mesh->mesh.ownsIndices = true;
+  return buildMesh(mesh, (uint8_t*) indices + indexSize);
+}
+
+uint32_t lovrMeshShapeGetVertexCount(MeshShape* mesh) {
+  return mesh->mesh.vertexCount;
+}
+
+uint32_t lovrMeshShapeGetTriangleCount(MeshShape* mesh) {
+  return mesh->mesh.indexCount / 3;
+}
+
+void* lovrMeshShapeSerialize(MeshShape* mesh, size_t* size) {
+  uint32_t vertexCount = mesh->mesh.vertexCount;
+  uint32_t indexCount = mesh->mesh.indexCount;
+  size_t vertexSize = 3 * vertexCount * sizeof(float);
+  size_t indexSize = indexCount * sizeof(uint32_t);
+  size_t flagSize = indexCount / 3;
+  *size = 4 * sizeof(uint32_t) + vertexSize + indexSize + flagSize;
+
+  uint32_t* header = malloc(*size);
+  lovrAssert(header, "Out of memory");
+  header[0] = MESH_CACHE_MAGIC;
+  header[1] = MESH_CACHE_VERSION;
+  header[2] = vertexCount;
+  header[3] = indexCount;
+
+  char* body = (char*) (header + 4);
+  const char* vertex = (const char*) mesh->mesh.vertices;
+  for (uint32_t i = 0; i < vertexCount; i++, vertex += mesh->mesh.vertexStride) {
+    memcpy(body + 3 * i * sizeof(float), vertex, 3 * sizeof(float));
+  }
+
+  memcpy(body + vertexSize, mesh->mesh.indices, indexSize);
+
+  dsizeint flagCount = 0;
+  const uint8_t* flags = dGeomTriMeshDataGet2(mesh->mesh.data, dTRIMESHDATA_USE_FLAGS, &flagCount);
+  if (flags) {
+    memcpy(body + vertexSize + indexSize, flags, flagSize);
+  } else {
+    memset(body + vertexSize + indexSize, 0xff, flagSize);
+  }
+
+  return header;
+}
+
+// ODE samples heights through a callback instead of copying them, so editing a region of the height
+// buffer only needs the vertical bounds to be refreshed.
+static dReal sampleTerrain(void* userdata, int x, int z) {
+  TerrainShape* terrain = userdata;
+  return terrain->terrain.heights[z * terrain->terrain.columns + x] * terrain->terrain.scale;
+}
+
+static void scanTerrainBounds(TerrainShape* terrain) {
+  uint32_t count = terrain->terrain.columns * terrain->terrain.rows;
+  terrain->terrain.minHeight = terrain->terrain.heights[0];
+  terrain->terrain.maxHeight = terrain->terrain.heights[0];
+  for (uint32_t i = 1; i < count; i++) {
+    terrain->terrain.minHeight = MIN(terrain->terrain.minHeight, terrain->terrain.heights[i]);
+    terrain->terrain.maxHeight = MAX(terrain->terrain.maxHeight, terrain->terrain.heights[i]);
+  }
+}
+
+static void updateTerrainBounds(TerrainShape* terrain) {
+  float min = terrain->terrain.minHeight * terrain->terrain.scale;
+  float max = terrain->terrain.maxHeight * terrain->terrain.scale;
+  dGeomHeightfieldDataSetBounds(terrain->terrain.data, MIN(min, max), MAX(min, max));
+}
+
+// Takes ownership of the heights, which must be allocated with malloc.  Heights are stored row by row
+// (rows run along the z axis) and the terrain is centered on the origin of the shape.
+TerrainShape* lovrTerrainShapeInit(TerrainShape* terrain, float* heights, uint32_t columns, uint32_t rows, float width, float depth, float scale) {
+  lovrAssert(columns >= 2 && rows >= 2, "Terrain must have at least 2x2 samples");
+  terrain->type = SHAPE_TERRAIN;
+  terrain->terrain.heights = heights;
+  terrain->terrain.columns = columns;
+  terrain->terrain.rows = rows;
+  terrain->terrain.width = width;
+  terrain->terrain.depth = depth;
+  terrain->terrain.scale = scale;
+  terrain->terrain.data = dGeomHeightfieldDataCreate();
+  dGeomHeightfieldDataBuildCallback(terrain->terrain.data, terrain, sampleTerrain, width, depth, columns, rows, 1., 0., 1., 0);
+  scanTerrainBounds(terrain);
+  updateTerrainBounds(terrain);
+  terrain->id = dCreateHeightfield(0, terrain->terrain.data, 1);
+  dGeomSetData(terrain->id, terrain);
+  return terrain;
+}
+
+void lovrTerrainShapeGetSampleCount(TerrainShape* terrain, uint32_t* columns, uint32_t* rows) {
+  *columns = terrain->terrain.columns;
+  *rows = terrain->terrain.rows;
+}
+
+void lovrTerrainShapeGetDimensions(TerrainShape* terrain, float* width, float* depth) {
+  *width = terrain->terrain.width;
+  *depth = terrain->terrain.depth;
+}
+
+float lovrTerrainShapeGetHeight(TerrainShape* terrain, uint32_t column, uint32_t row) {
+  lovrAssert(column < terrain->terrain.columns && row < terrain->terrain.rows, "Terrain sample (%d, %d) is out of range", column, row);
+  return terrain->terrain.heights[row * terrain->terrain.columns + column] * terrain->terrain.scale;
+}
+
+void lovrTerrainShapeSetHeights(TerrainShape* terrain, uint32_t column, uint32_t row, uint32_t columns, uint32_t rows, const float* heights) {
+  uint32_t totalColumns = terrain->terrain.columns;
+  uint32_t totalRows = terrain->terrain.rows;
+  lovrAssert(column <= totalColumns && columns <= totalColumns - column, "Terrain region is out of range");
+  lovrAssert(row <= totalRows && rows <= totalRows - row, "Terrain region is out of range");
+
+  // The bounds only grow to fit the new heights, unless a height that was the minimum or maximum got
+  // overwritten, in which case the whole terrain has to be scanned again
+  bool rescan = false;
+  float min = terrain->terrain.minHeight;
+  float max = terrain->terrain.maxHeight;
+  for (uint32_t i = 0; i < rows; i++) {
+    float* dst = terrain->terrain.heights + (row + i) * terrain->terrain.columns + column;
+    const float* src = heights + i * columns;
+    for (uint32_t j = 0; j < columns; j++) {
+      rescan |= dst[j] == terrain->terrain.minHeight || dst[j] == terrain->terrain.maxHeight;
+      min = MIN(min, src[j]);
+      max = MAX(max, src[j]);
+    }
+    memcpy(dst, src, columns * sizeof(float));
+  }
+
+  if (rescan) {
+    scanTerrainBounds(terrain);
+  } else {
+    terrain->terrain.minHeight = min;
+    terrain->terrain.maxHeight = max;
+  }
+
+  updateTerrainBounds(terrain);
+
+  // Resetting the body position flags the geom so its bounding box gets recomputed
+  if (terrain->collider) {
+    const dReal* position = dBodyGetPosition(terrain->collider->body);
+    dBodySetPosition(terrain->collider->body, position[0], position[1], position[2]);
+  }
+}
+
 void lovrJointDestroy(void* ref) {
   Joint* joint = ref;
   lovrJointDestroyData(joint);
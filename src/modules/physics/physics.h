@@ -6,15 +6,22 @@
 
 #pragma once
 
+struct ModelData;
+
 #define MAX_CONTACTS 4
 #define MAX_TAGS 16
 #define NO_TAG ~0
+#define MAX_PHYSICS_WORKERS 16
+#define POSE_STATE_FLOATS 13
+#define POSE_MATRIX_FLOATS 16
 
 typedef enum {
   SHAPE_SPHERE,
   SHAPE_BOX,
   SHAPE_CAPSULE,
-  SHAPE_CYLINDER
+  SHAPE_CYLINDER,
+  SHAPE_MESH,
+  SHAPE_TERRAIN
 } ShapeType;
 
 typedef enum {
@@ -24,16 +31,79 @@ typedef enum {
   JOINT_SLIDER
 } JointType;
 
+typedef enum {
+  BROADPHASE_HASH,
+  BROADPHASE_SAP,
+  BROADPHASE_QUADTREE,
+  BROADPHASE_SIMPLE
+} BroadphaseType;
+
+typedef struct {
+  BroadphaseType type;
+  bool splitStatic;
+  int minLevel;
+  int maxLevel;
+  int axisOrder;
+  float center[3];
+  float extents[3];
+  int depth;
+} BroadphaseInfo;
+
+typedef struct {
+  uint32_t pairs;
+  uint32_t contacts;
+} WorldStats;
+
+typedef enum {
+  RAYCAST_ALL,
+  RAYCAST_CLOSEST,
+  RAYCAST_ANY
+} RaycastMode;
+
+typedef enum {
+  POSE_STATE,
+  POSE_MATRIX
+} PoseFormat;
+
 typedef struct Collider Collider;
 
+typedef struct {
+  struct Shape* a;
+  struct Shape* b;
+  float position[3];
+  float normal[3];
+  float depth;
+  float impulse;
+} ContactEvent;
+
 typedef struct {
   dWorldID id;
   dSpaceID space;
+  dSpaceID staticSpace;
+  dSpaceID dynamicSpace;
+  WorldStats stats;
   dJointGroupID contactGroup;
   vec_void_t overlaps;
   map_int_t tags;
   uint16_t masks[MAX_TAGS];
+  uint16_t contactMasks[MAX_TAGS];
+  ContactEvent* contacts;
+  dJointFeedback* contactFeedback;
+  dJointID* contactJoints;
+  uint32_t contactCapacity;
+  uint32_t contactsWritten;
+  uint32_t contactEpoch;
+  vec_void_t contactShapes;
   Collider* head;
+  uint32_t colliderCount;
+  float stepSize;
+  uint32_t maxSubsteps;
+  float accumulator;
+  uint32_t threadCount;
+  dThreadingImplementationID threading;
+  dThreadingThreadPoolID threadPool;
+  dGeomID queryBox;
+  dGeomID querySphere;
 } World;
 
 struct Collider {
@@ -47,19 +117,47 @@ struct Collider {
   vec_void_t joints;
   float friction;
   float restitution;
+  float lastPosition[3];
+  float lastOrientation[4];
 };
 
-typedef struct {
+typedef struct Shape {
   ShapeType type;
   dGeomID id;
   Collider* collider;
   void* userdata;
+  World* contactWorld;
+  uint32_t contactEpoch;
+  struct {
+    dTriMeshDataID data;
+    float* vertices;
+    uint32_t* indices;
+    uint32_t vertexCount;
+    uint32_t vertexStride;
+    uint32_t indexCount;
+    bool ownsVertices;
+    bool ownsIndices;
+    struct ModelData* modelData;
+  } mesh;
+  struct {
+    dHeightfieldDataID data;
+    float* heights;
+    uint32_t columns;
+    uint32_t rows;
+    float width;
+    float depth;
+    float scale;
+    float minHeight;
+    float maxHeight;
+  } terrain;
 } Shape;
 
 typedef Shape SphereShape;
 typedef Shape BoxShape;
 typedef Shape CapsuleShape;
 typedef Shape CylinderShape;
+typedef Shape MeshShape;
+typedef Shape TerrainShape;
 
 typedef struct {
   JointType type;
@@ -80,17 +178,44 @@ typedef struct {
   void* userdata;
 } RaycastData;
 
+typedef struct {
+  Shape* shape;
+  uint32_t ray;
+  float position[3];
+  float normal[3];
+  float distance;
+} RaycastHit;
+
 bool lovrPhysicsInit(void);
 void lovrPhysicsDestroy(void);
+void lovrPhysicsDestroyThread(void);
+uint32_t lovrPhysicsGetWorkerCount(void);
+void lovrPhysicsSetWorkerCount(uint32_t count);
+void lovrPhysicsUpdateWorlds(World** worlds, uint32_t count, float dt);
 
-World* lovrWorldInit(World* world, float xg, float yg, float zg, bool allowSleep, const char** tags, int tagCount);
+World* lovrWorldInit(World* world, float xg, float yg, float zg, bool allowSleep, const char** tags, int tagCount, BroadphaseInfo* broadphase);
 #define lovrWorldCreate(...) lovrWorldInit(lovrAlloc(World), __VA_ARGS__)
 void lovrWorldDestroy(void* ref);
 void lovrWorldDestroyData(World* world);
-void lovrWorldUpdate(World* world, float dt, CollisionResolver resolver, void* userdata);
+uint32_t lovrWorldUpdate(World* world, float dt, CollisionResolver resolver, void* userdata);
+void lovrWorldGetStep(World* world, float* rate, uint32_t* maxSubsteps);
+void lovrWorldSetStep(World* world, float rate, uint32_t maxSubsteps);
+float lovrWorldGetInterpolation(World* world);
+const WorldStats* lovrWorldGetStats(World* world);
+uint32_t lovrWorldGetThreadCount(World* world);
+void lovrWorldSetThreadCount(World* world, uint32_t count);
 void lovrWorldComputeOverlaps(World* world);
 int lovrWorldGetNextOverlap(World* world, Shape** a, Shape** b);
+Shape** lovrWorldGetOverlaps(World* world, uint32_t* pairCount);
+uint32_t lovrWorldQueryAABB(World* world, float aabb[6], uint32_t tagMask, Shape** shapes, uint32_t capacity);
+uint32_t lovrWorldQueryBox(World* world, float position[3], float orientation[4], float size[3], uint32_t tagMask, Shape** shapes, uint32_t capacity);
+uint32_t lovrWorldQuerySphere(World* world, float position[3], float radius, uint32_t tagMask, Shape** shapes, uint32_t capacity);
 int lovrWorldCollide(World* world, Shape* a, Shape* b, float friction, float restitution);
+uint32_t lovrWorldGetContactCapacity(World* world);
+void lovrWorldSetContactCapacity(World* world, uint32_t capacity);
+uint32_t lovrWorldGetContacts(World* world, ContactEvent* contacts, uint32_t capacity);
+int lovrWorldDisableContactsBetween(World* world, const char* tag1, const char* tag2);
+int lovrWorldEnableContactsBetween(World* world, const char* tag1, const char* tag2);
 void lovrWorldGetGravity(World* world, float* x, float* y, float* z);
 void lovrWorldSetGravity(World* world, float x, float y, float z);
 void lovrWorldGetLinearDamping(World* world, float* damping, float* threshold);
@@ -100,6 +225,14 @@ void lovrWorldSetAngularDamping(World* world, float damping, float threshold);
 bool lovrWorldIsSleepingAllowed(World* world);
 void lovrWorldSetSleepingAllowed(World* world, bool allowed);
 void lovrWorldRaycast(World* world, float x1, float y1, float z1, float x2, float y2, float z2, RaycastCallback callback, void* userdata);
+uint32_t lovrWorldRaycastBatch(World* world, const float* rays, uint32_t rayCount, RaycastMode mode, uint32_t tagMask, RaycastHit* hits, uint32_t maxHits);
+uint32_t lovrWorldGetColliderCount(World* world);
+uint32_t lovrWorldGetPoses(World* world, Collider** colliders, uint32_t count, PoseFormat format, bool interpolate, float* data);
+uint32_t lovrWorldSetPoses(World* world, Collider** colliders, uint32_t count, PoseFormat format, const float* data);
+size_t lovrWorldGetStateSize(World* world);
+void lovrWorldSaveState(World* world, void* data);
+void lovrWorldRestoreState(World* world, const void* data, size_t size);
+int lovrWorldGetTag(World* world, const char* name);
 const char* lovrWorldGetTagName(World* world, int tag);
 int lovrWorldDisableCollisionBetween(World* world, const char* tag1, const char* tag2);
 int lovrWorldEnableCollisionBetween(World* world, const char* tag1, const char* tag2);
@@ -201,6 +334,25 @@ void lovrCylinderShapeSetRadius(CylinderShape* cylinder, float radius);
 float lovrCylinderShapeGetLength(CylinderShape* cylinder);
 void lovrCylinderShapeSetLength(CylinderShape* cylinder, float length);
 
+MeshShape* lovrMeshShapeInit(MeshShape* mesh, float* vertices, uint32_t vertexCount, uint32_t* indices, uint32_t indexCount);
+MeshShape* lovrMeshShapeInitFromModelData(MeshShape* mesh, struct ModelData* modelData, uint32_t nodeIndex);
+MeshShape* lovrMeshShapeInitFromCache(MeshShape* mesh, const void* data, size_t size);
+#define lovrMeshShapeCreate(...) lovrMeshShapeInit(lovrAlloc(MeshShape), __VA_ARGS__)
+#define lovrMeshShapeCreateFromModelData(...) lovrMeshShapeInitFromModelData(lovrAlloc(MeshShape), __VA_ARGS__)
+#define lovrMeshShapeCreateFromCache(...) lovrMeshShapeInitFromCache(lovrAlloc(MeshShape), __VA_ARGS__)
+#define lovrMeshShapeDestroy lovrShapeDestroy
+uint32_t lovrMeshShapeGetVertexCount(MeshShape* mesh);
+uint32_t lovrMeshShapeGetTriangleCount(MeshShape* mesh);
+void* lovrMeshShapeSerialize(MeshShape* mesh, size_t* size);
+
+TerrainShape* lovrTerrainShapeInit(TerrainShape* terrain, float* heights, uint32_t columns, uint32_t rows, float width, float depth, float scale);
+#define lovrTerrainShapeCreate(...) lovrTerrainShapeInit(lovrAlloc(TerrainShape), __VA_ARGS__)
+#define lovrTerrainShapeDestroy lovrShapeDestroy
+void lovrTerrainShapeGetSampleCount(TerrainShape* terrain, uint32_t* columns, uint32_t* rows);
+void lovrTerrainShapeGetDimensions(TerrainShape* terrain, float* width, float* depth);
+float lovrTerrainShapeGetHeight(TerrainShape* terrain, uint32_t column, uint32_t row);
+void lovrTerrainShapeSetHeights(TerrainShape* terrain, uint32_t column, uint32_t row, uint32_t columns, uint32_t rows, const float* heights);
+
 void lovrJointDestroy(void* ref);
 void lovrJointDestroyData(Joint* joint);
 JointType lovrJointGetType(Joint* joint);
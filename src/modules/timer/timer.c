@@ -1,7 +1,16 @@
 #include "timer/timer.h"
 #include "platform.h"
+#include "core/profiler.h"
+#include "util.h"
+#include <stdlib.h>
 #include <string.h>
 
+// Sleeps shorter than this are skipped in favor of spinning, since most schedulers can't hit them
+#define PACING_SPIN_THRESHOLD .0005
+
+// If the swap and compositor calls of a frame return faster than this, nothing is blocking the frame
+#define PACING_UNBLOCKED_FRAME .0005
+
 static struct {
   bool initialized;
   double lastTime;
@@ -12,16 +21,31 @@ static struct {
   double tickBuffer[TICK_SAMPLES];
   double averageDelta;
   int fps;
+  double* frameSamples;
+  uint32_t frameSampleCount;
+  uint32_t frameIndex;
+  uint64_t frameCount;
+  double* scratch;
+  PacingMode pacing;
+  double pacingDelta;
+  double deadline;
+  double blocked;
+  double sleepError;
 } state;
 
 bool lovrTimerInit() {
   if (state.initialized) return false;
   lovrTimerDestroy();
+  state.pacing = PACING_SLEEP;
+  state.pacingDelta = 1. / 60.;
+  lovrTimerSetSampleCount(DEFAULT_FRAME_SAMPLES);
   return state.initialized = true;
 }
 
 void lovrTimerDestroy() {
   if (!state.initialized) return;
+  free(state.frameSamples);
+  free(state.scratch);
   memset(&state, 0, sizeof(state));
 }
 
@@ -33,7 +57,9 @@ double lovrTimerGetTime() {
   return lovrPlatformGetTime();
 }
 
+// Stepping marks a frame boundary, so any zone still open on this thread was skipped over by an error
 double lovrTimerStep() {
+  LOVR_ZONE_UNWIND(0);
   state.lastTime = state.time;
   state.time = lovrPlatformGetTime();
   state.dt = state.time - state.lastTime;
@@ -45,6 +71,11 @@ double lovrTimerStep() {
   if (++state.tickIndex == TICK_SAMPLES) {
     state.tickIndex = 0;
   }
+  if (state.lastTime > 0.) {
+    state.frameSamples[state.frameIndex] = state.dt;
+    state.frameIndex = (state.frameIndex + 1) % state.frameSampleCount;
+    state.frameCount++;
+  }
   return state.dt;
 }
 
@@ -59,3 +90,133 @@ int lovrTimerGetFPS() {
 void lovrTimerSleep(double seconds) {
   lovrPlatformSleep(seconds);
 }
+
+uint32_t lovrTimerGetSampleCount() {
+  return state.frameSampleCount;
+}
+
+void lovrTimerSetSampleCount(uint32_t count) {
+  lovrAssert(count > 0, "Frame sample count must be positive");
+  free(state.frameSamples);
+  free(state.scratch);
+  state.frameSamples = calloc(count, sizeof(double));
+  state.scratch = malloc(count * sizeof(double));
+  lovrAssert(state.frameSamples && state.scratch, "Out of memory");
+  state.frameSampleCount = count;
+  state.frameIndex = 0;
+  state.frameCount = 0;
+}
+
+// Copies up to count of the most recent frame durations, oldest first
+uint32_t lovrTimerGetSamples(double* samples, uint32_t count) {
+  uint32_t available = (uint32_t) MIN(state.frameCount, (uint64_t) state.frameSampleCount);
+  count = MIN(count, available);
+  uint32_t start = (state.frameIndex + state.frameSampleCount - count) % state.frameSampleCount;
+  for (uint32_t i = 0; i < count; i++) {
+    samples[i] = state.frameSamples[(start + i) % state.frameSampleCount];
+  }
+  return count;
+}
+
+static int compareSamples(const void* a, const void* b) {
+  double x = *(const double*) a;
+  double y = *(const double*) b;
+  return (x > y) - (x < y);
+}
+
+static double percentile(double* sorted, uint32_t count, double p) {
+  uint32_t rank = (uint32_t) (p * count + .999999);
+  return sorted[CLAMP(rank, 1, count) - 1];
+}
+
+void lovrTimerGetStats(FrameStats* stats, double targetRate) {
+  memset(stats, 0, sizeof(*stats));
+  uint32_t count = lovrTimerGetSamples(state.scratch, state.frameSampleCount);
+
+  if (count == 0) {
+    return;
+  }
+
+  // A frame that took longer than 1.5 target intervals missed at least one display refresh
+  double targetDelta = 1. / targetRate;
+  for (uint32_t i = 0; i < count; i++) {
+    double intervals = state.scratch[i] / targetDelta;
+    if (intervals > 1.5) {
+      stats->dropped += (uint32_t) (intervals + .5) - 1;
+    }
+  }
+
+  qsort(state.scratch, count, sizeof(double), compareSamples);
+  stats->count = count;
+  stats->min = state.scratch[0];
+  stats->max = state.scratch[count - 1];
+  stats->p50 = percentile(state.scratch, count, .50);
+  stats->p95 = percentile(state.scratch, count, .95);
+  stats->p99 = percentile(state.scratch, count, .99);
+}
+
+PacingMode lovrTimerGetPacing(double* fps) {
+  *fps = 1. / state.pacingDelta;
+  return state.pacing;
+}
+
+void lovrTimerSetPacing(PacingMode mode, double fps) {
+  lovrAssert(fps > 0., "Target frame rate must be positive");
+  state.pacing = mode;
+  state.pacingDelta = 1. / fps;
+  state.deadline = 0.;
+}
+
+// Called by the main loop after every frame
+void lovrTimerPace() {
+  if (!state.initialized) return;
+
+  double now = lovrPlatformGetTime();
+
+  switch (state.pacing) {
+    case PACING_NONE:
+      break;
+
+    case PACING_SLEEP:
+      lovrPlatformSleep(.001);
+      break;
+
+    case PACING_FPS: {
+      state.deadline += state.pacingDelta;
+
+      // If the frame ran over its deadline, start a new cadence instead of trying to catch up
+      if (state.deadline <= now) {
+        state.deadline = now;
+        break;
+      }
+
+      // Sleep for most of the remaining time, leaving room for the measured oversleep of the OS
+      double duration = state.deadline - now - state.sleepError - PACING_SPIN_THRESHOLD;
+      if (duration > 0.) {
+        lovrPlatformSleep(duration);
+        double error = MAX(lovrPlatformGetTime() - now - duration, 0.);
+        state.sleepError += (error - state.sleepError) * (error > state.sleepError ? .5 : .05);
+      }
+
+      // Spin the rest of the way
+      while ((now = lovrPlatformGetTime()) < state.deadline);
+      break;
+    }
+
+    case PACING_COMPOSITOR:
+      // Frames are normally paced by the swap interval or the headset compositor, which report how
+      // long they blocked.  When neither one blocked (vsync disabled, minimized window), yield a little
+      // instead of spinning on the CPU.
+      if (state.blocked < PACING_UNBLOCKED_FRAME) {
+        lovrPlatformSleep(.001);
+      }
+      break;
+  }
+
+  state.blocked = 0.;
+}
+
+// Called around buffer swaps and compositor calls that wait for the display
+void lovrTimerAddBlockedTime(double seconds) {
+  state.blocked += seconds;
+}
@@ -1,8 +1,27 @@
 #include <stdbool.h>
+#include <stdint.h>
 
 #pragma once
 
 #define TICK_SAMPLES 90
+#define DEFAULT_FRAME_SAMPLES 1024
+
+typedef enum {
+  PACING_NONE,
+  PACING_SLEEP,
+  PACING_FPS,
+  PACING_COMPOSITOR
+} PacingMode;
+
+typedef struct {
+  uint32_t count;
+  uint32_t dropped;
+  double min;
+  double max;
+  double p50;
+  double p95;
+  double p99;
+} FrameStats;
 
 bool lovrTimerInit(void);
 void lovrTimerDestroy(void);
@@ -12,3 +31,11 @@ double lovrTimerStep(void);
 double lovrTimerGetAverageDelta(void);
 int lovrTimerGetFPS(void);
 void lovrTimerSleep(double seconds);
+PacingMode lovrTimerGetPacing(double* fps);
+void lovrTimerSetPacing(PacingMode mode, double fps);
+void lovrTimerPace(void);
+void lovrTimerAddBlockedTime(double seconds);
+uint32_t lovrTimerGetSampleCount(void);
+void lovrTimerSetSampleCount(uint32_t count);
+uint32_t lovrTimerGetSamples(double* samples, uint32_t count);
+void lovrTimerGetStats(FrameStats* stats, double targetRate);
@@ -70,10 +70,16 @@ function lovr.boot()
       width = 1080,
       height = 600,
       fullscreen = false,
+      headless = false,
       msaa = 0,
       title = 'LÖVR',
       icon = nil,
       vsync = 1
+    },
+    timer = {
+      pacing = 'sleep',
+      fps = 60,
+      samples = 1024
     }
   }
 
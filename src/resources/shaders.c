@@ -6,10 +6,20 @@ const char* lovrShaderVertexPrefix = ""
 "#define MAX_DRAWS 256 \n"
 "#define lovrView lovrViews[lovrViewportIndex] \n"
 "#define lovrProjection lovrProjections[lovrViewportIndex] \n"
-"#define lovrModel lovrModels[lovrDrawID] \n"
+"#ifdef FLAG_noInstanceAttributes \n"
+"#define lovrInstanceTransform mat4(1.) \n"
+"#define lovrInstanceColor vec4(1.) \n"
+"#else \n"
+"#define lovrInstanceTransform mat4(lovrInstanceTransform0, lovrInstanceTransform1, lovrInstanceTransform2, lovrInstanceTransform3) \n"
+"#endif \n"
+"#define lovrModel (lovrInstanceTransform * lovrModels[lovrDrawID]) \n"
 "#define lovrTransform (lovrView * lovrModel) \n"
 "#define lovrNormalMatrix mat3(transpose(inverse(lovrTransform))) \n"
+"#if MULTIVIEW \n"
+"#define lovrInstanceID gl_InstanceID \n"
+"#else \n"
 "#define lovrInstanceID (gl_InstanceID / lovrViewportCount) \n"
+"#endif \n"
 "#define lovrPoseMatrix ("
   "lovrPose[lovrBones[0]] * lovrBoneWeights[0] +"
   "lovrPose[lovrBones[1]] * lovrBoneWeights[1] +"
@@ -24,19 +34,36 @@ const char* lovrShaderVertexPrefix = ""
 "in uvec4 lovrBones; \n"
 "in vec4 lovrBoneWeights; \n"
 "in uint lovrDrawID; \n"
+"#ifndef FLAG_noInstanceAttributes \n"
+"in vec4 lovrInstanceTransform0; \n"
+"in vec4 lovrInstanceTransform1; \n"
+"in vec4 lovrInstanceTransform2; \n"
+"in vec4 lovrInstanceTransform3; \n"
+"in vec4 lovrInstanceColor; \n"
+"#endif \n"
 "out vec2 texCoord; \n"
 "out vec4 vertexColor; \n"
 "out vec4 lovrColor; \n"
 "layout(std140) uniform lovrModelBlock { mat4 lovrModels[MAX_DRAWS]; }; \n"
 "layout(std140) uniform lovrColorBlock { vec4 lovrColors[MAX_DRAWS]; }; \n"
+"struct lovrMaterialData { vec4 diffuseColor; vec4 emissiveColor; vec4 scalars; vec4 transform; }; \n"
+"layout(std140) uniform lovrMaterialBlock { lovrMaterialData lovrMaterials[MAX_DRAWS]; }; \n"
+"#define lovrMaterial lovrMaterials[lovrDrawID] \n"
+"#define lovrMaterialTransform mat3(vec3(lovrMaterial.transform.xy, 0.), vec3(lovrMaterial.transform.zw, 0.), vec3(lovrMaterial.scalars.zw, 1.)) \n"
+"flat out vec4 lovrDiffuseColor; \n"
+"flat out vec4 lovrEmissiveColor; \n"
+"flat out float lovrMetalness; \n"
+"flat out float lovrRoughness; \n"
 "uniform mat4 lovrViews[2]; \n"
 "uniform mat4 lovrProjections[2]; \n"
-"uniform mat3 lovrMaterialTransform; \n"
 "uniform float lovrPointSize; \n"
 "uniform mat4 lovrPose[MAX_BONES]; \n"
 "uniform int lovrViewportCount; \n"
 "#if SINGLEPASS \n"
 "#define lovrViewportIndex gl_ViewportIndex \n"
+"#elif MULTIVIEW \n"
+"#define lovrViewportIndex int(gl_ViewID_OVR) \n"
+"flat out int lovrViewID; \n"
 "#else \n"
 "uniform int lovrViewportIndex; \n"
 "#endif \n"
@@ -49,9 +76,15 @@ const char* lovrShaderVertexSuffix = ""
 "void main() { \n"
 "  texCoord = (lovrMaterialTransform * vec3(lovrTexCoord, 1.)).xy; \n"
 "  vertexColor = lovrVertexColor; \n"
-"  lovrColor = lovrColors[lovrDrawID]; \n"
+"  lovrColor = lovrColors[lovrDrawID] * lovrInstanceColor; \n"
+"  lovrDiffuseColor = lovrMaterial.diffuseColor; \n"
+"  lovrEmissiveColor = lovrMaterial.emissiveColor; \n"
+"  lovrMetalness = lovrMaterial.scalars.x; \n"
+"  lovrRoughness = lovrMaterial.scalars.y; \n"
 "#if SINGLEPASS \n"
 "  gl_ViewportIndex = gl_InstanceID % lovrViewportCount; \n"
+"#elif MULTIVIEW \n"
+"  lovrViewID = lovrViewportIndex; \n"
 "#endif \n"
 "  gl_PointSize = lovrPointSize; \n"
 "  vec4 vertexPosition = vec4(lovrPosition, 1.); \n"
@@ -68,10 +101,10 @@ const char* lovrShaderFragmentPrefix = ""
 "in vec4 vertexColor; \n"
 "in vec4 lovrColor; \n"
 "out vec4 lovrCanvas[gl_MaxDrawBuffers]; \n"
-"uniform float lovrMetalness; \n"
-"uniform float lovrRoughness; \n"
-"uniform vec4 lovrDiffuseColor; \n"
-"uniform vec4 lovrEmissiveColor; \n"
+"flat in vec4 lovrDiffuseColor; \n"
+"flat in vec4 lovrEmissiveColor; \n"
+"flat in float lovrMetalness; \n"
+"flat in float lovrRoughness; \n"
 "uniform sampler2D lovrDiffuseTexture; \n"
 "uniform sampler2D lovrEmissiveTexture; \n"
 "uniform sampler2D lovrMetalnessTexture; \n"
@@ -82,6 +115,9 @@ const char* lovrShaderFragmentPrefix = ""
 "uniform int lovrViewportCount; \n"
 "#if SINGLEPASS \n"
 "#define lovrViewportIndex gl_ViewportIndex \n"
+"#elif MULTIVIEW \n"
+"flat in int lovrViewID; \n"
+"#define lovrViewportIndex lovrViewID \n"
 "#else \n"
 "uniform int lovrViewportIndex; \n"
 "#endif \n"
@@ -157,16 +193,6 @@ const char* lovrFillVertexShader = ""
 "  return vertex; \n"
 "}";
 
-const char* lovrShaderScalarUniforms[] = {
-  "lovrMetalness",
-  "lovrRoughness"
-};
-
-const char* lovrShaderColorUniforms[] = {
-  "lovrDiffuseColor",
-  "lovrEmissiveColor"
-};
-
 const char* lovrShaderTextureUniforms[] = {
   "lovrDiffuseTexture",
   "lovrEmissiveTexture",
@@ -14,7 +14,5 @@ extern const char* lovrPanoFragmentShader;
 extern const char* lovrFontFragmentShader;
 extern const char* lovrFillVertexShader;
 
-extern const char* lovrShaderScalarUniforms[];
-extern const char* lovrShaderColorUniforms[];
 extern const char* lovrShaderTextureUniforms[];
 extern const char* lovrShaderAttributeNames[];